@@ -0,0 +1,239 @@
+/**
+ * @file bench_inversions.cpp
+ * @brief Micro-benchmark for the inversion counters (make bench).
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * What it measures:
+ * - Every registered counter (counter_engine.hpp), the auto counter and three_way_inv,
+ *   on generated position arrays of N = 10^3 .. 10^8 (decades).
+ * - Inputs: random permutation, nearly sorted (1% random swaps), reversed,
+ *   heavy duplicates (16 distinct values) and block-shuffled (sqrt(N) blocks).
+ *
+ * Per (counter, input, N) it reports, as one JSON document on stdout (or --out FILE):
+ * - ns_per_elem : best of the timed repetitions (repeat until ~0.2 s or 50 runs).
+ * - allocs / alloc_bytes : operator new calls and bytes during one run (warm scratch).
+ * - peak_heap_bytes : highest live heap during that run, above what was live before it.
+ * - peak_rss_kb : VmHWM after the case (reset per case through /proc/self/clear_refs
+ *                 where the kernel allows it, otherwise the process-wide ru_maxrss).
+ *
+ * Options:
+ *   --min-n N --max-n N          range (accepts 1e6 style), default 1e3 .. 1e8
+ *   --counters a,b,...            subset of: merge,bit,quick,auto,three_way
+ *   --inputs a,b,...              subset of: random,nearly_sorted,reversed,heavy_dup,block_shuffled
+ *   --out FILE                    write JSON there instead of stdout
+ *
+ * SSR: generate input -> warm up -> time best-of -> count allocations -> JSON row.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "counter_engine.hpp"
+#include "inversions.hpp"
+
+using namespace std;
+
+// ---- Allocation accounting (global operator new/delete for this binary) ------
+// A 16-byte header keeps the size so delete can update the live byte count.
+static atomic<long long> g_allocs{0}, g_alloc_bytes{0}, g_live{0}, g_peak{0};
+
+static void* counted_alloc(size_t n) {
+    void* p = std::malloc(n + 16);
+    if (!p) throw std::bad_alloc();
+    *static_cast<size_t*>(p) = n;
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_alloc_bytes.fetch_add((long long)n, memory_order_relaxed);
+    long long live = g_live.fetch_add((long long)n, memory_order_relaxed) + (long long)n;
+    long long peak = g_peak.load(memory_order_relaxed);
+    while (live > peak && !g_peak.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+    return static_cast<char*>(p) + 16;
+}
+
+static void counted_free(void* p) {
+    if (!p) return;
+    char* base = static_cast<char*>(p) - 16;
+    g_live.fetch_sub((long long)*reinterpret_cast<size_t*>(base), memory_order_relaxed);
+    std::free(base);
+}
+
+void* operator new(size_t n) { return counted_alloc(n); }
+void* operator new[](size_t n) { return counted_alloc(n); }
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p); }
+
+// ---- Peak RSS -------------------------------------------------------------------
+static long long read_hwm_kb() {
+    ifstream in("/proc/self/status");
+    string line;
+    while (getline(in, line))
+        if (line.rfind("VmHWM:", 0) == 0) return atoll(line.c_str() + 6);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (long long)ru.ru_maxrss; // KiB on Linux
+}
+
+// Writing "5" resets VmHWM to the current RSS (Linux >= 4.0); harmless if it fails.
+static void reset_hwm() {
+    ofstream out("/proc/self/clear_refs");
+    if (out) out << "5";
+}
+
+// ---- Input generators (fixed seeds, values in 1..n like real position arrays) ----
+static vector<long long> make_input(const string& kind, size_t n) {
+    vector<long long> a(n);
+    mt19937_64 rng(n * 31 + kind.size());
+    iota(a.begin(), a.end(), 1);
+    if (kind == "random") {
+        shuffle(a.begin(), a.end(), rng);
+    } else if (kind == "nearly_sorted") {
+        for (size_t k = 0; k < n / 100 + 1 && n > 1; ++k) swap(a[rng() % n], a[rng() % n]);
+    } else if (kind == "reversed") {
+        reverse(a.begin(), a.end());
+    } else if (kind == "heavy_dup") {
+        for (auto& x : a) x = 1 + (long long)(rng() % 16);
+    } else if (kind == "block_shuffled") {
+        size_t b = max<size_t>(1, (size_t)sqrt((double)n));
+        vector<size_t> blocks((n + b - 1) / b);
+        iota(blocks.begin(), blocks.end(), 0);
+        shuffle(blocks.begin(), blocks.end(), rng);
+        vector<long long> out;
+        out.reserve(n);
+        for (size_t blk : blocks)
+            for (size_t i = blk * b; i < min(n, blk * b + b); ++i) out.push_back(a[i]);
+        a.swap(out);
+    }
+    return a;
+}
+
+static vector<string> split_list(const string& s) {
+    vector<string> out;
+    stringstream in(s);
+    string tok;
+    while (getline(in, tok, ',')) if (!tok.empty()) out.push_back(tok);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    size_t min_n = 1000, max_n = 100000000;
+    vector<string> counters = {"merge", "bit", "quick", "auto", "three_way"};
+    vector<string> inputs = {"random", "nearly_sorted", "reversed", "heavy_dup", "block_shuffled"};
+    string out_path;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Usage: " << argv[0]
+                 << " [--min-n N] [--max-n N] [--counters a,b] [--inputs a,b] [--out FILE]\n";
+            return 1;
+        }
+        string val = argv[++i];
+        if (arg == "--min-n" || arg == "--max-n") {
+            double v = atof(val.c_str());
+            if (!(v >= 1 && v <= 1e18)) { // also keeps n *= 10 from looping on 0
+                cerr << arg << " must be a size between 1 and 1e18\n";
+                return 1;
+            }
+            (arg == "--min-n" ? min_n : max_n) = (size_t)v;
+        }
+        else if (arg == "--counters") counters = split_list(val);
+        else if (arg == "--inputs") inputs = split_list(val);
+        else if (arg == "--out") out_path = val;
+        else {
+            cerr << "Unknown flag: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (min_n > max_n) {
+        cerr << "--min-n (" << min_n << ") is larger than --max-n (" << max_n << ")\n";
+        return 1;
+    }
+    for (auto& c : counters) {
+        if (c != "auto" && c != "three_way" && !find_counter(c)) {
+            cerr << "Unknown counter: " << c << "\n";
+            return 1;
+        }
+    }
+
+    ostringstream json;
+    json << "{\n  \"benchmark\": \"inversions\",\n  \"results\": [";
+    bool first = true;
+    CounterScratch cs;
+
+    for (size_t n = min_n; n <= max_n; n *= 10) {
+        for (auto& kind : inputs) {
+            vector<long long> a = make_input(kind, n);
+            for (auto& name : counters) {
+                const CounterEngine* eng = find_counter(name);
+                auto run = [&]()->long long{
+                    if (eng) return eng->count(a, cs);
+                    if (name == "auto") { const char* used; return auto_count(a, cs, used); }
+                    return three_way_inv(a, cs).merge_inv;
+                };
+
+                reset_hwm();
+                long long inv = run(); // warm-up: sizes the scratch, faults pages in
+
+                // One counted run.
+                long long live0 = g_live.load(), allocs0 = g_allocs.load(), bytes0 = g_alloc_bytes.load();
+                g_peak.store(live0);
+                run();
+                long long allocs = g_allocs.load() - allocs0;
+                long long alloc_bytes = g_alloc_bytes.load() - bytes0;
+                long long peak_heap = g_peak.load() - live0;
+
+                // Timed runs: best of, until ~0.2 s spent (at least one, at most 50).
+                double best = 1e300, spent = 0;
+                for (int r = 0; r < 50 && (r == 0 || spent < 0.2); ++r) {
+                    auto t0 = chrono::steady_clock::now();
+                    volatile long long sink = run();
+                    (void)sink;
+                    double dt = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+                    best = min(best, dt);
+                    spent += dt;
+                }
+                long long rss = read_hwm_kb();
+
+                json << (first ? "\n" : ",\n") << "    {\"counter\": \"" << name
+                     << "\", \"input\": \"" << kind << "\", \"n\": " << n
+                     << ", \"inversions\": " << inv
+                     << ", \"ns_per_elem\": " << (n ? best * 1e9 / (double)n : 0.0)
+                     << ", \"allocs\": " << allocs << ", \"alloc_bytes\": " << alloc_bytes
+                     << ", \"peak_heap_bytes\": " << peak_heap << ", \"peak_rss_kb\": " << rss << "}";
+                first = false;
+                cerr << "[bench] " << name << " " << kind << " n=" << n << " "
+                     << (n ? best * 1e9 / (double)n : 0.0) << " ns/elem\n";
+            }
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    if (out_path.empty()) {
+        cout << json.str();
+    } else {
+        ofstream out(out_path);
+        out << json.str();
+        if (!out) {
+            cerr << "Failed to write " << out_path << "\n";
+            return 4;
+        }
+    }
+    return 0;
+}
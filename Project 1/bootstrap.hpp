@@ -0,0 +1,153 @@
+/**
+ * @file bootstrap.hpp
+ * @brief --bootstrap B: percentile confidence intervals for every source's reliability.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * One replicate:
+ * 1) Resample the universe: U draws with replacement give each item a weight w (0, 1, 2, ...).
+ *    An item drawn k times acts as k tied copies.
+ * 2) Rebuild the Borda consensus on the resample. A source's rank of an item becomes
+ *    (weight of the lines before its last occurrence) + the mean rank of its copies, doubled
+ *    so it stays an integer. Missing items get the doubled weighted missing_rank. Ties are
+ *    broken by the same lexicographic rank as the real consensus.
+ * 3) Per source, walk its lines (then, if it has fewer lines than the resample has copies,
+ *    its missing items in consensus order, as the position arrays do) and count
+ *    weighted inversions, sum of w_a * w_b over discordant pairs, with a right-to-left
+ *    weighted Fenwick sweep. Max = pairs of distinct copies = (W^2 - sum w^2) / 2.
+ * With every weight = 1 this is exactly the normal pipeline (same order, same counts).
+ *
+ * Replicates run on the pool. Replicate b seeds its own RNG with (seed, b), so results do
+ * not depend on the thread count. Each worker reuses U-sized scratch arrays, so nothing is
+ * allocated after a worker's first replicate.
+ *
+ * SSR: multinomial weights -> weighted Borda -> sort (sum, lex) -> weighted inversions -> percentiles.
+ */
+#ifndef BOOTSTRAP_HPP
+#define BOOTSTRAP_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "consensus.hpp"
+#include "work_pool.hpp"
+
+/**
+ * @brief Reliability of every source in B bootstrap replicates.
+ *
+ * @param ranks built from @p src_items (used for the last-occurrence rule)
+ * @param lex   lexicographic rank per item ID (tie-break of the consensus)
+ * @return B x S values, replicate-major: rel[b*S + s]
+ */
+inline std::vector<double> bootstrap_reliability(const std::vector<std::vector<uint32_t>>& src_items,
+                                                 const RankMatrix& ranks, const std::vector<uint32_t>& lex,
+                                                 int B, uint64_t seed, WorkStealingPool& pool) {
+    const int S = ranks.S;
+    const uint32_t U = ranks.U;
+    std::vector<double> rel((size_t)B * S, 1.0);
+    if (U == 0 || B <= 0) return rel;
+
+    struct Scratch {
+        std::vector<uint32_t> w, cpos, stamp, order;
+        std::vector<long long> sum, fen;
+    };
+    std::vector<Scratch> scratch(pool.size());
+
+    pool.run((size_t)B, [&](int wk, size_t b){
+        Scratch& sc = scratch[wk];
+        if (sc.w.size() != U) {
+            sc.w.assign(U, 0); sc.cpos.assign(U, 0); sc.stamp.assign(U, 0);
+            sc.sum.assign(U, 0); sc.fen.assign(U + 1, 0);
+            sc.order.reserve(U);
+        }
+        std::vector<uint32_t>& w = sc.w;
+        std::fill(w.begin(), w.end(), 0);
+        std::mt19937_64 rng(seed ^ (0x9E3779B97F4A7C15ull * (b + 1)));
+        std::uniform_int_distribution<uint32_t> draw(0, U - 1);
+        for (uint32_t k = 0; k < U; ++k) ++w[draw(rng)];
+
+        // Weighted source lengths -> shared missing rank (longest + 1, doubled).
+        long long max_len = 0;
+        for (int s = 0; s < S; ++s) {
+            long long len = 0;
+            for (uint32_t id : src_items[s]) len += w[id];
+            max_len = std::max(max_len, len);
+        }
+        const long long missing2 = 2 * (max_len + 1);
+
+        // Weighted Borda sums over the drawn items.
+        std::vector<long long>& sum = sc.sum;
+        std::vector<uint32_t>& order = sc.order;
+        order.clear();
+        for (uint32_t id = 0; id < U; ++id) {
+            sum[id] = (long long)S * missing2;
+            if (w[id]) order.push_back(id);
+        }
+        for (int s = 0; s < S; ++s) {
+            const std::vector<uint32_t>& l = src_items[s];
+            long long cum = 0;
+            for (size_t i = 0; i < l.size(); ++i) {
+                uint32_t id = l[i];
+                if (ranks.at(s, id) == (int32_t)(i + 1) && w[id])
+                    sum[id] += 2 * cum + w[id] + 1 - missing2; // replace the missing rank
+                cum += w[id];
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t c){
+            return sum[a] != sum[c] ? sum[a] < sum[c] : lex[a] < lex[c];
+        });
+        for (size_t k = 0; k < order.size(); ++k) sc.cpos[order[k]] = (uint32_t)(k + 1);
+
+        long long W = 0, W2 = 0;
+        for (uint32_t id : order) { W += w[id]; W2 += (long long)w[id] * w[id]; }
+        const double max_inv = (double)(W * W - W2) / 2.0;
+        const size_t K = order.size();
+
+        // Weighted inversions per source: right-to-left, inv += w * (weight seen with smaller pos).
+        for (int s = 0; s < S; ++s) {
+            const std::vector<uint32_t>& l = src_items[s];
+            const uint32_t st = (uint32_t)(b * S + s + 1); // unique per (replicate, source)
+            std::fill(sc.fen.begin(), sc.fen.begin() + K + 1, 0);
+            long long inv = 0;
+            auto visit = [&](uint32_t id){
+                long long wi = w[id];
+                uint32_t p = sc.cpos[id];
+                long long seen = 0;
+                for (uint32_t i = p - 1; i > 0; i -= i & (0u - i)) seen += sc.fen[i];
+                inv += wi * seen;
+                for (uint32_t i = p; i <= K; i += i & (0u - i)) sc.fen[i] += wi;
+            };
+            // Sweep order reversed: missing items (consensus order) come last in the array.
+            // Like the position arrays, they are only appended when the lines are fewer than the items.
+            long long len = 0;
+            for (uint32_t id : l) { sc.stamp[id] = st; len += w[id]; }
+            if (len < W)
+                for (size_t k = K; k-- > 0;) if (sc.stamp[order[k]] != st) visit(order[k]);
+            for (size_t i = l.size(); i-- > 0;) if (w[l[i]]) visit(l[i]);
+            rel[b * S + s] = max_inv > 0 ? 1.0 - (double)inv / max_inv : 1.0;
+        }
+    });
+    return rel;
+}
+
+/**
+ * @brief Two-sided percentile interval of @p v (sorted in place), linear interpolation.
+ */
+inline void percentile_interval(std::vector<double>& v, double level, double& lo, double& hi) {
+    if (v.empty()) { lo = hi = 0; return; }
+    std::sort(v.begin(), v.end());
+    auto q = [&](double p){
+        double x = p * (double)(v.size() - 1);
+        size_t i = (size_t)std::floor(x);
+        size_t j = std::min(v.size() - 1, i + 1);
+        return v[i] + (v[j] - v[i]) * (x - (double)i);
+    };
+    lo = q((1 - level) / 2);
+    hi = q(1 - (1 - level) / 2);
+}
+
+#endif
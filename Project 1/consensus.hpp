@@ -0,0 +1,287 @@
+/**
+ * @file consensus.hpp
+ * @brief Rank matrix + Borda (sum-of-ranks) aggregation for the consensus order.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * Layout:
+ * - One flat int32 matrix, source-major: rank of item id in source s is r[s*U + id].
+ *   That is 4 bytes per (item, source) instead of a heap vector per item.
+ * - Items a source does not list keep missing_rank (= longest source + 1), written by a
+ *   single bulk fill before the per-source scatter.
+ *
+ * Borda sums are column sums of that matrix. We add whole rows into a block of
+ * accumulators with SIMD adds (SSE2 on x86-64, NEON on arm64, scalar otherwise), so the
+ * pass streams through memory instead of chasing pointers.
+ *
+ * Ordering:
+ * - Consensus = items by (sum asc, item string asc). avg = sum/S adds nothing as a key.
+ * - We pack (sum - min_sum, item ID) into one uint64 and LSD radix sort the keys, so the
+ *   universe is ordered by sum with a few linear passes. Only runs of equal sums are
+ *   then sorted by string; with spread-out sums those runs are short, so there are few
+ *   string compares (all items tied is the worst case: one full string sort).
+ *
+ * SSR: bulk-fill missing -> scatter ranks -> vector column sums -> radix sort (sum, id)
+ *      -> string sort inside equal-sum runs.
+ */
+#ifndef CONSENSUS_HPP
+#define CONSENSUS_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "work_pool.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * @brief Source-major S x U rank matrix (1-based ranks, missing_rank for absent items).
+ */
+struct RankMatrix {
+    int S = 0;
+    uint32_t U = 0;
+    int32_t missing_rank = 0;
+    std::vector<int32_t> r;
+
+    const int32_t* row(int s) const { return r.data() + (size_t)s * U; }
+    int32_t at(int s, uint32_t id) const { return r[(size_t)s * U + id]; }
+};
+
+// Ranks are int32 and missing_rank = longest source + 1 must fit as well.
+constexpr size_t RANK_MAX_SOURCE_LEN = (size_t)INT32_MAX - 1;
+
+/**
+ * @brief Index of the first source longer than RANK_MAX_SOURCE_LEN, or -1 if none.
+ *
+ * Callers must reject such inputs before build_rank_matrix: their ranks would wrap.
+ */
+inline long long first_overlong_source(const std::vector<std::vector<uint32_t>>& src_items) {
+    for (size_t s = 0; s < src_items.size(); ++s)
+        if (src_items[s].size() > RANK_MAX_SOURCE_LEN) return (long long)s;
+    return -1;
+}
+
+/**
+ * @brief Build the rank matrix from per-source ID lists.
+ *
+ * Same rules as before: rank = 1-based line index; if an item repeats inside a source
+ * the last occurrence wins; missing_rank = longest source + 1.
+ * Every source must hold at most RANK_MAX_SOURCE_LEN lines (see first_overlong_source).
+ */
+inline RankMatrix build_rank_matrix(const std::vector<std::vector<uint32_t>>& src_items, uint32_t U) {
+    RankMatrix m;
+    m.S = (int)src_items.size();
+    m.U = U;
+    size_t max_len = 0;
+    for (auto& l : src_items) max_len = std::max(max_len, l.size());
+    m.missing_rank = (int32_t)(max_len + 1);
+    m.r.assign((size_t)m.S * U, m.missing_rank);
+    for (int s = 0; s < m.S; ++s) {
+        int32_t* row = m.r.data() + (size_t)s * U;
+        const std::vector<uint32_t>& l = src_items[s];
+        for (size_t i = 0; i < l.size(); ++i) row[l[i]] = (int32_t)(i + 1);
+    }
+    return m;
+}
+
+// acc[c] += row[c] for c in [0, n), 32-bit lanes.
+inline void add_row_i32(int32_t* acc, const int32_t* row, size_t n) {
+    size_t c = 0;
+#if defined(__SSE2__)
+    for (; c + 8 <= n; c += 8) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(acc + c));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(acc + c + 4));
+        a0 = _mm_add_epi32(a0, _mm_loadu_si128((const __m128i*)(row + c)));
+        a1 = _mm_add_epi32(a1, _mm_loadu_si128((const __m128i*)(row + c + 4)));
+        _mm_storeu_si128((__m128i*)(acc + c), a0);
+        _mm_storeu_si128((__m128i*)(acc + c + 4), a1);
+    }
+#elif defined(__ARM_NEON)
+    for (; c + 8 <= n; c += 8) {
+        vst1q_s32(acc + c,     vaddq_s32(vld1q_s32(acc + c),     vld1q_s32(row + c)));
+        vst1q_s32(acc + c + 4, vaddq_s32(vld1q_s32(acc + c + 4), vld1q_s32(row + c + 4)));
+    }
+#endif
+    for (; c < n; ++c) acc[c] += row[c];
+}
+
+// acc[c] += row[c] for c in [0, n), widening to 64-bit lanes (ranks are >= 1).
+inline void add_row_i64(long long* acc, const int32_t* row, size_t n) {
+    size_t c = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; c + 4 <= n; c += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(row + c));
+        __m128i lo = _mm_unpacklo_epi32(v, zero);
+        __m128i hi = _mm_unpackhi_epi32(v, zero);
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(acc + c));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(acc + c + 2));
+        _mm_storeu_si128((__m128i*)(acc + c),     _mm_add_epi64(a0, lo));
+        _mm_storeu_si128((__m128i*)(acc + c + 2), _mm_add_epi64(a1, hi));
+    }
+#elif defined(__ARM_NEON)
+    for (; c + 4 <= n; c += 4) {
+        int32x4_t v = vld1q_s32(row + c);
+        int64_t* a = (int64_t*)(acc + c);
+        vst1q_s64(a,     vaddw_s32(vld1q_s64(a),     vget_low_s32(v)));
+        vst1q_s64(a + 2, vaddw_s32(vld1q_s64(a + 2), vget_high_s32(v)));
+    }
+#endif
+    for (; c < n; ++c) acc[c] += row[c];
+}
+
+/**
+ * @brief Borda sums: sum[id] = sum over sources of rank(s, id).
+ *
+ * Columns are done in blocks that fit in L1; every source row streams through once
+ * per block. If S * missing_rank fits in int32 we accumulate 4 lanes per 128-bit add
+ * and widen once per block, otherwise we add straight into 64-bit lanes.
+ */
+inline std::vector<long long> borda_sums(const RankMatrix& m) {
+    constexpr size_t BLOCK = 4096;
+    std::vector<long long> sum(m.U, 0);
+    const bool narrow = (long long)m.S * m.missing_rank <= 0x7FFFFFFFLL;
+    std::vector<int32_t> acc(narrow ? BLOCK : 0);
+    for (size_t c0 = 0; c0 < m.U; c0 += BLOCK) {
+        size_t n = std::min<size_t>(BLOCK, m.U - c0);
+        if (narrow) {
+            std::fill(acc.begin(), acc.begin() + n, 0);
+            for (int s = 0; s < m.S; ++s) add_row_i32(acc.data(), m.row(s) + c0, n);
+            for (size_t c = 0; c < n; ++c) sum[c0 + c] = acc[c];
+        } else {
+            for (int s = 0; s < m.S; ++s) add_row_i64(sum.data() + c0, m.row(s) + c0, n);
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Lexicographic order of all items (a full string sort: O(U log U) compares).
+ *
+ * Only the bootstrap needs it (its replicate sums tie differently); the consensus
+ * itself uses consensus_order below.
+ *
+ * @param view   callable id -> std::string_view (e.g. ItemInterner::view)
+ * @param by_lex receives IDs sorted by string; returns lex[id] = position in by_lex.
+ */
+template <class ViewFn>
+inline std::vector<uint32_t> lexicographic_ranks(uint32_t U, ViewFn view, std::vector<uint32_t>& by_lex) {
+    by_lex.resize(U);
+    for (uint32_t id = 0; id < U; ++id) by_lex[id] = id;
+    std::sort(by_lex.begin(), by_lex.end(), [&](uint32_t a, uint32_t b){ return view(a) < view(b); });
+    std::vector<uint32_t> lex(U);
+    for (uint32_t i = 0; i < U; ++i) lex[by_lex[i]] = i;
+    return lex;
+}
+
+/**
+ * @brief Stable LSD radix sort of uint64 keys on bits [low_bit, key_bits).
+ *
+ * 11-bit digits (2048 buckets fit in L1). A digit where every key lands in one bucket
+ * is skipped. With a pool of > 1 threads each pass builds per-chunk histograms and
+ * scatters chunks in parallel; chunk offsets keep every pass stable, so keys that agree
+ * on the sorted bits keep their input order.
+ */
+inline void radix_sort_u64(std::vector<uint64_t>& keys, int key_bits, WorkStealingPool* pool = nullptr,
+                           int low_bit = 0) {
+    constexpr int DIGIT = 11;
+    constexpr size_t B = (size_t)1 << DIGIT;
+    const size_t n = keys.size();
+    if (n < 2) return;
+    std::vector<uint64_t> tmp(n);
+    const size_t chunks = (pool && pool->size() > 1 && n >= ((size_t)1 << 16)) ? (size_t)pool->size() * 4 : 1;
+    std::vector<size_t> hist(chunks * B);
+
+    uint64_t* src = keys.data();
+    uint64_t* dst = tmp.data();
+    for (int shift = low_bit; shift < key_bits; shift += DIGIT) {
+        std::fill(hist.begin(), hist.end(), 0);
+        auto count_chunk = [&](int, size_t c){
+            size_t lo = n * c / chunks, hi = n * (c + 1) / chunks;
+            size_t* h = hist.data() + c * B;
+            for (size_t i = lo; i < hi; ++i) ++h[(src[i] >> shift) & (B - 1)];
+        };
+        if (chunks > 1) pool->run(chunks, count_chunk); else count_chunk(0, 0);
+
+        // Exclusive prefix over (digit, chunk) so chunk c writes after chunks < c.
+        size_t total = 0;
+        bool single_bucket = false;
+        for (size_t d = 0; d < B; ++d) {
+            size_t bucket = 0;
+            for (size_t c = 0; c < chunks; ++c) {
+                size_t v = hist[c * B + d];
+                hist[c * B + d] = total;
+                total += v;
+                bucket += v;
+            }
+            if (bucket == n) single_bucket = true;
+        }
+        if (single_bucket) continue;
+
+        auto scatter_chunk = [&](int, size_t c){
+            size_t lo = n * c / chunks, hi = n * (c + 1) / chunks;
+            size_t* h = hist.data() + c * B;
+            for (size_t i = lo; i < hi; ++i) dst[h[(src[i] >> shift) & (B - 1)]++] = src[i];
+        };
+        if (chunks > 1) pool->run(chunks, scatter_chunk); else scatter_chunk(0, 0);
+        std::swap(src, dst);
+    }
+    if (src != keys.data()) std::copy(src, src + n, keys.data());
+}
+
+/**
+ * @brief Consensus order: item IDs by (sum asc, item string asc).
+ *
+ * Same order as sorting by (sum, avg, item) because avg = sum/S. Stable radix sort of
+ * (sum - min_sum, id) keys on the sum bits, then a string sort of every run of equal sums. If (sum range, id)
+ * cannot be packed into 64 bits we fall back to one comparison sort on (sum, string).
+ *
+ * @param view callable id -> std::string_view (e.g. ItemInterner::view)
+ */
+template <class ViewFn>
+inline std::vector<uint32_t> consensus_order(const std::vector<long long>& sums, ViewFn view,
+                                             WorkStealingPool* pool = nullptr) {
+    const size_t U = sums.size();
+    std::vector<uint32_t> order(U);
+    if (U == 0) return order;
+    auto by_string = [&](uint32_t a, uint32_t b){ return view(a) < view(b); };
+    long long lo = *std::min_element(sums.begin(), sums.end());
+    long long hi = *std::max_element(sums.begin(), sums.end());
+    auto bits_for = [](unsigned long long v){ int b = 0; while (v) { ++b; v >>= 1; } return b; };
+    const int id_bits = bits_for(U - 1);
+    const int sum_bits = bits_for((unsigned long long)(hi - lo));
+
+    if (id_bits + sum_bits > 64) {
+        for (size_t i = 0; i < U; ++i) order[i] = (uint32_t)i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+            return sums[a] != sums[b] ? sums[a] < sums[b] : by_string(a, b);
+        });
+        return order;
+    }
+
+    // Keys start in ID order and the sort is stable, so only the sum bits need passes.
+    std::vector<uint64_t> keys(U);
+    for (size_t id = 0; id < U; ++id)
+        keys[id] = ((uint64_t)(sums[id] - lo) << id_bits) | (uint64_t)id;
+    radix_sort_u64(keys, id_bits + sum_bits, pool, id_bits);
+    const uint64_t id_mask = ((uint64_t)1 << id_bits) - 1; // id_bits <= 32
+    for (size_t i = 0; i < U; ++i) order[i] = (uint32_t)(keys[i] & id_mask);
+
+    // Equal sums are adjacent (in ID order): only those runs need the string tie-break.
+    for (size_t i = 0; i < U;) {
+        size_t j = i + 1;
+        while (j < U && (keys[j] >> id_bits) == (keys[i] >> id_bits)) ++j;
+        if (j - i > 1) std::sort(order.begin() + i, order.begin() + j, by_string);
+        i = j;
+    }
+    return order;
+}
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file external_inversions.hpp
+ * @brief Out-of-core inversion counting: sorted runs on a spill file + k-way merge passes.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * When to use:
+ * - The position array (plus merge scratch) does not fit in RAM. Values are pushed one by
+ *   one, so the array itself never has to exist in memory; only mem_limit bytes do.
+ *
+ * How it works:
+ * 1) Run formation: fill a chunk of mem_limit / (2 * sizeof(T)) values, count its
+ *    inversions with merge_count_blocked (which also sorts it), append it to the spill file.
+ * 2) Merge passes: up to F consecutive runs at a time are merged through one read buffer
+ *    each (F = buffers that fit in mem_limit). When a value leaves run j, every value
+ *    still waiting in an earlier run i < j is larger (ties leave the earlier run first),
+ *    so it adds sum(remaining[0..j)) inversions. A small BIT over the F runs keeps that sum.
+ * 3) Groups are consecutive, so later passes count the pairs across groups. The final
+ *    pass only counts; nothing is written.
+ *
+ * I/O is large sequential pread/write calls on an unlinked temp file (gone on close).
+ * Use T = uint32_t whenever every value is < 2^32: half the bytes of every pass.
+ *
+ * SSR: chunk -> count + sort -> spill run -> k-way merge, add earlier-runs-remaining -> repeat.
+ */
+#ifndef EXTERNAL_INVERSIONS_HPP
+#define EXTERNAL_INVERSIONS_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "inversions.hpp"
+
+// Smallest budget a counter accepts (smaller limits are raised to this).
+constexpr size_t EXT_MIN_MEM = (size_t)1 << 16;
+
+/**
+ * @brief Anonymous scratch file (created in a directory, unlinked right away).
+ */
+class SpillFile {
+public:
+    SpillFile() = default;
+    ~SpillFile() { if (fd_ >= 0) ::close(fd_); }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    bool create(const std::string& dir) {
+        std::string tmpl = dir + "/rkspillXXXXXX";
+        fd_ = mkstemp(&tmpl[0]);
+        if (fd_ < 0) return false;
+        ::unlink(tmpl.c_str());
+        size_ = 0;
+        return true;
+    }
+
+    bool append(const void* p, size_t bytes) {
+        const char* c = static_cast<const char*>(p);
+        while (bytes > 0) {
+            ssize_t w = ::write(fd_, c, bytes);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            c += w; bytes -= (size_t)w; size_ += (uint64_t)w;
+        }
+        return true;
+    }
+
+    bool read_at(void* p, size_t bytes, uint64_t off) const {
+        char* c = static_cast<char*>(p);
+        while (bytes > 0) {
+            ssize_t r = ::pread(fd_, c, bytes, (off_t)off);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            c += r; bytes -= (size_t)r; off += (uint64_t)r;
+        }
+        return true;
+    }
+
+    uint64_t size() const { return size_; }
+
+    void swap(SpillFile& o) { std::swap(fd_, o.fd_); std::swap(size_, o.size_); }
+
+private:
+    int fd_ = -1;
+    uint64_t size_ = 0;
+};
+
+/**
+ * @brief Streaming inversion counter bounded by @p mem_limit bytes.
+ *
+ * API:
+ *   ExternalInversionCounter<uint32_t> c(256 << 20, "/tmp");
+ *   for (...) c.push(x);
+ *   long long inv;
+ *   if (!c.finish(inv)) error();   // I/O failure (disk full, bad dir)
+ */
+template <class T>
+class ExternalInversionCounter {
+public:
+    ExternalInversionCounter(size_t mem_limit, std::string dir) : dir_(std::move(dir)) {
+        mem_ = std::max<size_t>(mem_limit, EXT_MIN_MEM);
+        chunk_.reserve(std::max<size_t>(mem_ / (2 * sizeof(T)), MERGE_TILE));
+    }
+
+    void push(T x) {
+        chunk_.push_back(x);
+        if (chunk_.size() == chunk_.capacity()) spill_chunk();
+    }
+
+    bool finish(long long& inv) {
+        // Everything fit in one chunk: plain in-memory count, no file at all.
+        if (runs_.empty()) {
+            std::vector<T> tmp(chunk_.size());
+            inv = merge_count_blocked(chunk_.data(), tmp.data(), chunk_.size());
+            return true;
+        }
+        if (!chunk_.empty()) spill_chunk();
+        std::vector<T>().swap(chunk_); // give the chunk's memory to the merge buffers
+        if (!ok_) return false;
+
+        // Read buffers: as many as fit, plus one for output. Aim for 64 KiB - 8 MiB each,
+        // but never more than mem_ / 3, so the minimum fan-in of 2 (+ output) stays in mem_.
+        size_t buf_bytes = std::max<size_t>((size_t)1 << 16, std::min<size_t>(mem_ / 64, (size_t)8 << 20));
+        size_t buf_elems = std::max<size_t>(1, std::min(buf_bytes, mem_ / 3) / sizeof(T));
+        size_t fan_in = std::max<size_t>(2, mem_ / (buf_elems * sizeof(T)) - 1);
+
+        SpillFile* in = &file_;
+        SpillFile next;
+        while (ok_ && runs_.size() > 1) {
+            bool last = runs_.size() <= fan_in;
+            SpillFile out;
+            if (!last && !out.create(dir_)) return false;
+            std::vector<Run> merged;
+            for (size_t g = 0; g < runs_.size(); g += fan_in) {
+                size_t e = std::min(runs_.size(), g + fan_in);
+                uint64_t start = out.size() / sizeof(T);
+                inv_ += merge_group(*in, g, e, buf_elems, last ? nullptr : &out);
+                merged.push_back({start, out.size() / sizeof(T) - start});
+            }
+            runs_.swap(merged);
+            if (!last) { next.swap(out); in = &next; } // out now holds the spent input
+        }
+        inv = inv_;
+        return ok_;
+    }
+
+private:
+    struct Run { uint64_t off, len; }; // in elements
+
+    std::string dir_;
+    size_t mem_;
+    std::vector<T> chunk_;
+    std::vector<Run> runs_;
+    SpillFile file_;
+    long long inv_ = 0;
+    bool ok_ = true;
+
+    void spill_chunk() {
+        if (runs_.empty() && !file_.create(dir_)) ok_ = false;
+        // The merge kernel needs a scratch twin; capacity was sized for both.
+        std::vector<T> tmp(chunk_.size());
+        inv_ += merge_count_blocked(chunk_.data(), tmp.data(), chunk_.size());
+        tmp = std::vector<T>();
+        uint64_t off = file_.size() / sizeof(T);
+        if (ok_) ok_ = file_.append(chunk_.data(), chunk_.size() * sizeof(T));
+        runs_.push_back({off, (uint64_t)chunk_.size()});
+        chunk_.clear();
+    }
+
+    // Merge runs [g, e) of @p in; writes the merged run to @p out unless it is null.
+    long long merge_group(const SpillFile& in, size_t g, size_t e, size_t buf_elems, SpillFile* out) {
+        struct Cursor { uint64_t next, left; std::vector<T> buf; size_t i = 0; };
+        const int k = (int)(e - g);
+        std::vector<Cursor> cur(k);
+        BIT remaining(k);
+        using Head = std::pair<T, int>;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+        auto refill = [&](Cursor& c)->bool{
+            size_t n = (size_t)std::min<uint64_t>(c.left, buf_elems);
+            c.buf.resize(n);
+            c.i = 0;
+            if (n && !in.read_at(c.buf.data(), n * sizeof(T), c.next * sizeof(T))) { ok_ = false; return false; }
+            c.next += n; c.left -= n;
+            return n > 0;
+        };
+        for (int j = 0; j < k; ++j) {
+            const Run& r = runs_[g + j];
+            cur[j].next = r.off;
+            cur[j].left = r.len;
+            remaining.add(j + 1, (long long)r.len);
+            if (refill(cur[j])) heap.push({cur[j].buf[0], j});
+        }
+
+        std::vector<T> obuf;
+        if (out) obuf.reserve(buf_elems);
+        long long inv = 0;
+        while (ok_ && !heap.empty()) {
+            auto [x, j] = heap.top();
+            heap.pop();
+            inv += remaining.sum(j);      // values still waiting in runs before j
+            remaining.add(j + 1, -1);
+            if (out) {
+                obuf.push_back(x);
+                if (obuf.size() == buf_elems) { ok_ = out->append(obuf.data(), obuf.size() * sizeof(T)); obuf.clear(); }
+            }
+            Cursor& c = cur[j];
+            if (++c.i < c.buf.size() || refill(c)) heap.push({c.buf[c.i], j});
+        }
+        if (out && ok_ && !obuf.empty()) ok_ = out->append(obuf.data(), obuf.size() * sizeof(T));
+        return inv;
+    }
+};
+
+#endif
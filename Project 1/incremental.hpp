@@ -0,0 +1,562 @@
+/**
+ * @file incremental.hpp
+ * @brief Long-running consensus + per-source inversion counts under append/move/remove deltas.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * What we keep up to date (same definitions as the batch run, for sources without repeats):
+ * - Borda key of every item: sum = (ranks where present) + missing_count * missing_rank,
+ *   ties by item string; missing_rank = longest source + 1.
+ * - The consensus order by that key.
+ * - For every source s, inversions of its position array: present items in source order,
+ *   then missing items in consensus order.
+ *
+ * Structures:
+ * - BlockSeq: a sequence cut into ~sqrt(N) blocks with a Fenwick tree over block sizes
+ *   (the BIT from inversions.hpp, now counting items per block). rank() is O(log N),
+ *   "u before v?" is O(1), insert/erase/adjacent swap touch one block.
+ *   Every source is a BlockSeq, and so is the consensus.
+ * - cnt_[s][block]: how many items of a consensus block are present in source s, so
+ *   "present items of s ahead of x in the consensus" is O(sqrt N).
+ * - Kinetic certificates: when missing_rank moves, items with different missing counts
+ *   slide at different speeds. Each adjacent consensus pair with different missing
+ *   counts stores the missing_rank at which it would flip; a heap pops only the pairs
+ *   that really flip, so a new longest source does not touch the whole universe.
+ *
+ * Cost per delta:
+ * - A consensus swap of neighbours u, v changes every source by exactly +-1 or 0: O(S).
+ * - append: O(sqrt N) (+ O(S sqrt N) when the item is new to the universe).
+ * - move/remove: O(d) rank shifts for the d items between the old and new slot, since
+ *   each of their Borda sums changes by one; plus O(S) per consensus swap that causes.
+ *
+ * Sources must not repeat an item (a feed "move" needs one slot per item); the loader
+ * keeps the last occurrence, like the batch ranks. The earlier copies are dropped, so
+ * a source that repeats lines gets smaller ranks (and counts) here than in the batch run.
+ *
+ * SSR: sqrt-blocked sequences + BIT over blocks -> O(1) pair order -> +-1 inversion deltas per swap.
+ */
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inversions.hpp"
+#include "source_loader.hpp"
+
+/**
+ * @brief Ordered sequence of distinct uint32 IDs in blocks, Fenwick over block sizes.
+ *
+ * Blocks have stable handles; order_ lists handles in sequence order and pos_ is the
+ * inverse. A block over 2*B items is split (on_split lets owners refresh per-block data).
+ */
+class BlockSeq {
+public:
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+    std::function<void(uint32_t, uint32_t)> on_split; // (old handle, new handle)
+
+    void build(const std::vector<uint32_t>& seq, uint32_t universe, size_t block) {
+        B_ = std::max<size_t>(block, 16);
+        blocks_.clear(); order_.clear();
+        h_of_.assign(universe, NONE);
+        idx_of_.assign(universe, 0);
+        n_ = seq.size();
+        for (size_t i = 0; i < seq.size(); i += B_) {
+            uint32_t h = (uint32_t)blocks_.size();
+            blocks_.emplace_back(seq.begin() + i, seq.begin() + std::min(seq.size(), i + B_));
+            order_.push_back(h);
+            for (size_t k = 0; k < blocks_[h].size(); ++k) place(blocks_[h][k], h, k);
+        }
+        if (blocks_.empty()) { blocks_.emplace_back(); order_.push_back(0); }
+        reindex();
+    }
+
+    void reserve_ids(uint32_t universe) {
+        if (h_of_.size() < universe) { h_of_.resize(universe, NONE); idx_of_.resize(universe, 0); }
+    }
+
+    size_t size() const { return n_; }
+    bool contains(uint32_t id) const { return id < h_of_.size() && h_of_[id] != NONE; }
+    uint32_t handle_of(uint32_t id) const { return h_of_[id]; }
+    uint32_t index_in_block(uint32_t id) const { return idx_of_[id]; }
+    const std::vector<uint32_t>& block(uint32_t h) const { return blocks_[h]; }
+    const std::vector<uint32_t>& order() const { return order_; }
+    uint32_t block_pos(uint32_t h) const { return pos_[h]; }
+    size_t block_count() const { return blocks_.size(); }
+
+    // 0-based rank of a contained id.
+    size_t rank(uint32_t id) const { return prefix(pos_[h_of_[id]]) + idx_of_[id]; }
+
+    // Is u earlier than v? Both must be contained.
+    bool before(uint32_t u, uint32_t v) const {
+        uint32_t pu = pos_[h_of_[u]], pv = pos_[h_of_[v]];
+        return pu != pv ? pu < pv : idx_of_[u] < idx_of_[v];
+    }
+
+    uint32_t at(size_t k) const {
+        size_t p = find_pos(k);
+        return blocks_[order_[p]][k - prefix(p)];
+    }
+
+    uint32_t next(uint32_t id) const {
+        uint32_t h = h_of_[id], i = idx_of_[id];
+        if (i + 1 < blocks_[h].size()) return blocks_[h][i + 1];
+        for (size_t p = pos_[h] + 1; p < order_.size(); ++p)
+            if (!blocks_[order_[p]].empty()) return blocks_[order_[p]].front();
+        return NONE;
+    }
+
+    uint32_t prev(uint32_t id) const {
+        uint32_t h = h_of_[id], i = idx_of_[id];
+        if (i > 0) return blocks_[h][i - 1];
+        for (size_t p = pos_[h]; p-- > 0;)
+            if (!blocks_[order_[p]].empty()) return blocks_[order_[p]].back();
+        return NONE;
+    }
+
+    // Insert @p id so that it gets 0-based rank @p k (k <= size()).
+    void insert_at(size_t k, uint32_t id) {
+        uint32_t h;
+        size_t local;
+        if (k == n_) {
+            h = order_.back();
+            local = blocks_[h].size();
+        } else {
+            size_t p = find_pos(k);
+            h = order_[p];
+            local = k - prefix(p);
+        }
+        std::vector<uint32_t>& b = blocks_[h];
+        b.insert(b.begin() + local, id);
+        for (size_t t = local; t < b.size(); ++t) place(b[t], h, t);
+        ++n_;
+        fen_add(pos_[h], +1);
+        if (b.size() > 2 * B_) split(h);
+    }
+
+    void push_back(uint32_t id) { insert_at(n_, id); }
+
+    void erase(uint32_t id) {
+        uint32_t h = h_of_[id], i = idx_of_[id];
+        std::vector<uint32_t>& b = blocks_[h];
+        b.erase(b.begin() + i);
+        for (size_t t = i; t < b.size(); ++t) idx_of_[b[t]] = (uint32_t)t;
+        h_of_[id] = NONE;
+        --n_;
+        fen_add(pos_[h], -1);
+    }
+
+    // u is directly before v; afterwards v is directly before u.
+    void swap_adjacent(uint32_t u, uint32_t v) {
+        uint32_t hu = h_of_[u], iu = idx_of_[u], hv = h_of_[v], iv = idx_of_[v];
+        blocks_[hu][iu] = v;
+        blocks_[hv][iv] = u;
+        place(v, hu, iu);
+        place(u, hv, iv);
+    }
+
+    // f(id) for 0-based ranks [lo, hi).
+    template <class F>
+    void for_range(size_t lo, size_t hi, F f) const {
+        if (lo >= hi) return;
+        size_t p = find_pos(lo);
+        size_t i = lo - prefix(p);
+        for (size_t left = hi - lo; left > 0; ++p, i = 0) {
+            const std::vector<uint32_t>& b = blocks_[order_[p]];
+            for (; i < b.size() && left > 0; ++i, --left) f(b[i]);
+        }
+    }
+
+    std::vector<uint32_t> to_vector() const {
+        std::vector<uint32_t> out;
+        out.reserve(n_);
+        for (uint32_t h : order_) out.insert(out.end(), blocks_[h].begin(), blocks_[h].end());
+        return out;
+    }
+
+private:
+    size_t B_ = 512, n_ = 0;
+    std::vector<std::vector<uint32_t>> blocks_;
+    std::vector<uint32_t> order_, pos_;
+    std::vector<long long> fen_; // 1-based Fenwick over block sizes in sequence order
+    std::vector<uint32_t> h_of_, idx_of_;
+
+    void place(uint32_t id, uint32_t h, size_t i) { h_of_[id] = h; idx_of_[id] = (uint32_t)i; }
+
+    void fen_add(size_t p, long long v) { for (size_t i = p + 1; i < fen_.size(); i += i & (~i + 1)) fen_[i] += v; }
+    // Items in blocks at sequence positions [0, p).
+    size_t prefix(size_t p) const { long long s = 0; for (size_t i = p; i > 0; i -= i & (~i + 1)) s += fen_[i]; return (size_t)s; }
+    // Sequence position of the block holding 0-based rank k (Fenwick descent).
+    size_t find_pos(size_t k) const {
+        size_t pos = 0, step = 1;
+        while (step * 2 < fen_.size()) step *= 2;
+        long long rem = (long long)k;
+        for (; step > 0; step >>= 1) {
+            if (pos + step < fen_.size() && fen_[pos + step] <= rem) { pos += step; rem -= fen_[pos]; }
+        }
+        return pos; // blocks [0, pos) hold <= k items, so rank k lives in block pos
+    }
+
+    void reindex() {
+        pos_.assign(blocks_.size(), 0);
+        for (size_t p = 0; p < order_.size(); ++p) pos_[order_[p]] = (uint32_t)p;
+        fen_.assign(order_.size() + 1, 0);
+        for (size_t p = 0; p < order_.size(); ++p) {
+            size_t i = p + 1;
+            fen_[i] += (long long)blocks_[order_[p]].size();
+            size_t j = i + (i & (~i + 1));
+            if (j < fen_.size()) fen_[j] += fen_[i];
+        }
+    }
+
+    void split(uint32_t h) {
+        uint32_t h2 = (uint32_t)blocks_.size();
+        std::vector<uint32_t>& b = blocks_[h];
+        std::vector<uint32_t> tail(b.begin() + B_, b.end());
+        b.resize(B_);
+        blocks_.push_back(std::move(tail));
+        for (size_t t = 0; t < blocks_[h2].size(); ++t) place(blocks_[h2][t], h2, t);
+        order_.insert(order_.begin() + pos_[h] + 1, h2);
+        reindex();
+        if (on_split) on_split(h, h2);
+    }
+};
+
+/**
+ * @brief The incremental engine: consensus, Borda keys and inversions under source deltas.
+ *
+ * All public edits return an empty string on success or a message saying why the delta
+ * was rejected (state is then unchanged).
+ */
+class IncrementalConsensus {
+public:
+    static constexpr uint32_t NONE = BlockSeq::NONE;
+
+    IncrementalConsensus(ItemInterner& items, const std::vector<std::vector<uint32_t>>& lists)
+        : items_(items), S_((int)lists.size()) {
+        const uint32_t U = items_.size();
+        size_t max_len = 0;
+        for (auto& l : lists) max_len = std::max(max_len, l.size());
+        M_ = (long long)max_len + 1;
+        base_.assign(U, 0);
+        mc_.assign(U, S_);
+        src_.resize(S_);
+        size_t blk = (size_t)std::sqrt((double)std::max<size_t>(U, 1)) + 1;
+        for (int s = 0; s < S_; ++s) {
+            src_[s].build(lists[s], U, blk);
+            for (size_t i = 0; i < lists[s].size(); ++i) {
+                base_[lists[s][i]] += (long long)(i + 1);
+                --mc_[lists[s][i]];
+            }
+        }
+
+        std::vector<uint32_t> order(U);
+        for (uint32_t id = 0; id < U; ++id) order[id] = id;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return less(a, b); });
+        cons_.build(order, U, blk);
+        cons_.on_split = [this](uint32_t h, uint32_t h2){ refresh_counts(h); refresh_counts(h2); };
+        cnt_.assign(S_, std::vector<uint32_t>());
+        for (uint32_t h = 0; h < cons_.block_count(); ++h) refresh_counts(h);
+
+        inv_.assign(S_, 0);
+        MergeScratch ms;
+        for (int s = 0; s < S_; ++s) inv_[s] = merge_count(position_array(s), ms);
+        recertify_all();
+    }
+
+    // on_split captures this; the engine stays where it was built.
+    IncrementalConsensus(const IncrementalConsensus&) = delete;
+    IncrementalConsensus& operator=(const IncrementalConsensus&) = delete;
+
+    int sources() const { return S_; }
+    long long universe() const { return (long long)cons_.size(); }
+    long long max_inversions() const { long long N = universe(); return N * (N - 1) / 2; }
+    long long inversions(int s) const { return inv_[s]; }
+    long long missing_rank() const { return M_; }
+    long long borda_sum(uint32_t id) const { return key(id); }
+    std::vector<uint32_t> consensus() const { return cons_.to_vector(); }
+    std::vector<uint32_t> source_list(int s) const { return src_[s].to_vector(); }
+
+    // Add @p item at the end of source s (it must not be listed there yet).
+    std::string append(int s, std::string_view item) {
+        uint32_t x = items_.find(item);
+        if (x != NONE && src_[s].contains(x)) return "item already in source (use move)";
+        if (x == NONE && items_.full()) return "item dictionary is full";
+        if (x == NONE || !cons_.contains(x)) x = add_to_universe(item);
+
+        // x leaves the missing tail of s: it now precedes the missing items ahead of it.
+        inv_[s] += (long long)cons_.rank(x) - (long long)present_ahead(s, x);
+        src_[s].push_back(x);
+        ++cnt_[s][cons_.handle_of(x)];
+        --mc_[x];
+        base_[x] += (long long)src_[s].size();
+        fix(x);
+
+        if ((long long)src_[s].size() + 1 > M_) set_missing_rank((long long)src_[s].size() + 1);
+        return "";
+    }
+
+    // Move @p item inside source s to 1-based position @p pos (clamped).
+    std::string move(int s, std::string_view item, size_t pos) {
+        uint32_t x = items_.find(item);
+        if (x == NONE || !src_[s].contains(x)) return "item not in source";
+        const size_t len = src_[s].size();
+        size_t i = src_[s].rank(x);
+        size_t j = std::min(std::max<size_t>(pos, 1), len) - 1;
+        if (i == j) return "";
+
+        std::vector<uint32_t> between;
+        if (j < i) src_[s].for_range(j, i, [&](uint32_t y){ between.push_back(y); });
+        else       src_[s].for_range(i + 1, j + 1, [&](uint32_t y){ between.push_back(y); });
+        // x jumps over every y: each pair flips its orientation in s.
+        for (uint32_t y : between) {
+            bool x_first_in_cons = cons_.before(x, y);
+            if (j < i) inv_[s] += x_first_in_cons ? -1 : +1; // was y,x -> now x,y
+            else       inv_[s] += x_first_in_cons ? +1 : -1; // was x,y -> now y,x
+        }
+        src_[s].erase(x);
+        src_[s].insert_at(j, x);
+
+        base_[x] += (long long)j - (long long)i;
+        fix(x);
+        const long long shift = j < i ? +1 : -1;
+        for (uint32_t y : between) { base_[y] += shift; fix(y); }
+        return "";
+    }
+
+    // Drop @p item from source s (it joins that source's missing tail).
+    std::string remove(int s, std::string_view item) {
+        uint32_t x = items_.find(item);
+        if (x == NONE || !src_[s].contains(x)) return "item not in source";
+        const size_t len = src_[s].size();
+        size_t i = src_[s].rank(x);
+
+        std::vector<uint32_t> after;
+        src_[s].for_range(i + 1, len, [&](uint32_t y){ after.push_back(y); });
+        for (uint32_t y : after) inv_[s] += cons_.before(x, y) ? +1 : -1; // x,y -> y,x
+        // Pairs (x, missing m) with m ahead of x in the consensus stop being inversions.
+        inv_[s] -= (long long)cons_.rank(x) - (long long)present_ahead(s, x);
+
+        src_[s].erase(x);
+        --cnt_[s][cons_.handle_of(x)];
+        ++mc_[x];
+        base_[x] -= (long long)(i + 1);
+        fix(x);
+        for (uint32_t y : after) { base_[y] -= 1; fix(y); }
+
+        if (mc_[x] == S_) drop_from_universe(x);
+        long long longest = 0;
+        for (auto& l : src_) longest = std::max(longest, (long long)l.size());
+        if (longest + 1 != M_) set_missing_rank(longest + 1);
+        return "";
+    }
+
+    /**
+     * @brief Recompute everything from scratch (sort + merge_count) and compare.
+     *
+     * Debug aid for the session loop; returns "" when the incremental state is exact.
+     */
+    std::string verify() const {
+        std::vector<uint32_t> ids = cons_.to_vector();
+        std::vector<long long> sum(items_.size(), 0);
+        std::vector<int> miss(items_.size(), 0);
+        for (uint32_t id : ids) miss[id] = S_;
+        size_t longest = 0;
+        std::vector<std::vector<uint32_t>> lists(S_);
+        for (int s = 0; s < S_; ++s) {
+            lists[s] = src_[s].to_vector();
+            longest = std::max(longest, lists[s].size());
+            for (size_t i = 0; i < lists[s].size(); ++i) { sum[lists[s][i]] += (long long)(i + 1); --miss[lists[s][i]]; }
+        }
+        const long long M = (long long)longest + 1;
+        std::vector<uint32_t> order = ids;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+            long long ka = sum[a] + miss[a] * M, kb = sum[b] + miss[b] * M;
+            if (ka != kb) return ka < kb;
+            return items_.view(a) < items_.view(b);
+        });
+        if (M != M_) return "missing_rank differs";
+        if (order != ids) return "consensus order differs";
+        for (uint32_t id : ids) if (sum[id] + miss[id] * M != key(id)) return "borda sum differs";
+        MergeScratch ms;
+        for (int s = 0; s < S_; ++s)
+            if (merge_count(position_array(s), ms) != inv_[s]) return "inversions differ for source " + std::to_string(s + 1);
+        return "";
+    }
+
+private:
+    struct Cert { long long m; uint32_t u, v; };
+    struct CertLater { bool operator()(const Cert& a, const Cert& b) const { return a.m > b.m; } };
+    struct CertEarlier { bool operator()(const Cert& a, const Cert& b) const { return a.m < b.m; } };
+
+    ItemInterner& items_;
+    int S_;
+    long long M_;                           // missing_rank
+    std::vector<long long> base_;           // sum of ranks over sources that list the item
+    std::vector<int> mc_;                   // number of sources missing the item
+    std::vector<BlockSeq> src_;             // per-source order
+    BlockSeq cons_;                         // consensus order
+    std::vector<std::vector<uint32_t>> cnt_; // cnt_[s][block]: present-in-s items per consensus block
+    std::vector<long long> inv_;
+    // Flip points for adjacent pairs with different missing counts.
+    std::priority_queue<Cert, std::vector<Cert>, CertLater> rise_;   // flips when M grows to m
+    std::priority_queue<Cert, std::vector<Cert>, CertEarlier> fall_; // flips when M shrinks to m
+
+    long long key(uint32_t id) const { return base_[id] + (long long)mc_[id] * M_; }
+
+    bool less(uint32_t a, uint32_t b) const {
+        long long ka = key(a), kb = key(b);
+        if (ka != kb) return ka < kb;
+        return items_.view(a) < items_.view(b);
+    }
+
+    std::vector<long long> position_array(int s) const {
+        std::vector<long long> a;
+        a.reserve(cons_.size());
+        for (uint32_t id : src_[s].to_vector()) a.push_back((long long)cons_.rank(id) + 1);
+        for (uint32_t id : cons_.to_vector()) if (!src_[s].contains(id)) a.push_back((long long)cons_.rank(id) + 1);
+        return a;
+    }
+
+    void refresh_counts(uint32_t h) {
+        for (int s = 0; s < S_; ++s) {
+            if (cnt_[s].size() < cons_.block_count()) cnt_[s].resize(cons_.block_count(), 0);
+            uint32_t c = 0;
+            for (uint32_t id : cons_.block(h)) c += src_[s].contains(id);
+            cnt_[s][h] = c;
+        }
+    }
+
+    // Items present in source s that sit ahead of x in the consensus.
+    size_t present_ahead(int s, uint32_t x) const {
+        uint32_t h = cons_.handle_of(x);
+        size_t c = 0;
+        const std::vector<uint32_t>& ord = cons_.order();
+        for (size_t p = 0; p < cons_.block_pos(h); ++p) c += cnt_[s][ord[p]];
+        const std::vector<uint32_t>& b = cons_.block(h);
+        for (size_t i = 0; i < cons_.index_in_block(x); ++i) c += src_[s].contains(b[i]);
+        return c;
+    }
+
+    // u directly before v in the consensus; swap them and fix every source's count.
+    void swap_cons(uint32_t u, uint32_t v) {
+        uint32_t hu = cons_.handle_of(u), hv = cons_.handle_of(v);
+        for (int s = 0; s < S_; ++s) {
+            bool pu = src_[s].contains(u), pv = src_[s].contains(v);
+            if (pu && pv) inv_[s] += src_[s].before(u, v) ? +1 : -1;
+            else if (pu) inv_[s] += 1;  // present u stays ahead of missing v, now out of order
+            else if (pv) inv_[s] -= 1;  // present v ahead of missing u, now in order
+            if (hu != hv && pu != pv) {
+                if (pu) { --cnt_[s][hu]; ++cnt_[s][hv]; }
+                else    { --cnt_[s][hv]; ++cnt_[s][hu]; }
+            }
+        }
+        cons_.swap_adjacent(u, v);
+        uint32_t p = cons_.prev(v);
+        if (p != NONE) certify(p);
+        certify(v);
+        certify(u);
+    }
+
+    // Restore consensus order around x after its key changed.
+    void fix(uint32_t x) {
+        for (uint32_t p; (p = cons_.prev(x)) != NONE && less(x, p);) swap_cons(p, x);
+        for (uint32_t n; (n = cons_.next(x)) != NONE && less(n, x);) swap_cons(x, n);
+        uint32_t p = cons_.prev(x);
+        if (p != NONE) certify(p);
+        certify(x);
+    }
+
+    uint32_t add_to_universe(std::string_view item) {
+        uint32_t x = items_.intern(item);
+        const uint32_t U = items_.size();
+        if (base_.size() < U) { base_.resize(U, 0); mc_.resize(U, S_); }
+        for (auto& l : src_) l.reserve_ids(U);
+        cons_.reserve_ids(U);
+        base_[x] = 0;
+        mc_[x] = S_;
+
+        // Binary search for x's slot by key.
+        size_t lo = 0, hi = cons_.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (less(cons_.at(mid), x)) lo = mid + 1; else hi = mid;
+        }
+        cons_.insert_at(lo, x);
+        // x is missing everywhere: it is an inversion with each present item behind it.
+        for (int s = 0; s < S_; ++s)
+            inv_[s] += (long long)src_[s].size() - (long long)present_ahead(s, x);
+        uint32_t p = cons_.prev(x);
+        if (p != NONE) certify(p);
+        certify(x);
+        return x;
+    }
+
+    void drop_from_universe(uint32_t x) {
+        for (int s = 0; s < S_; ++s)
+            inv_[s] -= (long long)src_[s].size() - (long long)present_ahead(s, x);
+        uint32_t p = cons_.prev(x);
+        cons_.erase(x);
+        if (p != NONE) certify(p);
+    }
+
+    static long long floor_div(long long a, long long b) { long long q = a / b; return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q; }
+
+    // Record at which missing_rank the pair (u, next(u)) would flip.
+    void certify(uint32_t u) {
+        uint32_t v = cons_.next(u);
+        if (v == NONE) return;
+        long long d = (long long)mc_[u] - mc_[v];
+        if (d == 0) return;
+        const bool u_after_on_tie = items_.view(u) > items_.view(v);
+        if (d > 0) {
+            long long D = base_[v] - base_[u];
+            long long q = floor_div(D, d);
+            rise_.push({(D % d == 0 && u_after_on_tie) ? q : q + 1, u, v});
+        } else {
+            long long k = -d, E = base_[u] - base_[v];
+            long long q = -floor_div(-E, k); // ceil(E / k)
+            fall_.push({(E % k == 0 && u_after_on_tie) ? q : q - 1, u, v});
+        }
+        if (rise_.size() + fall_.size() > 4 * cons_.size() + 1024) recertify_all();
+    }
+
+    void recertify_all() {
+        rise_ = decltype(rise_)();
+        fall_ = decltype(fall_)();
+        std::vector<uint32_t> ids = cons_.to_vector();
+        for (size_t i = 0; i + 1 < ids.size(); ++i) {
+            uint32_t u = ids[i], v = ids[i + 1];
+            if (mc_[u] == mc_[v]) continue;
+            certify(u);
+        }
+    }
+
+    bool still_flipped(const Cert& c) const {
+        return cons_.contains(c.u) && cons_.contains(c.v) && cons_.next(c.u) == c.v && less(c.v, c.u);
+    }
+
+    void set_missing_rank(long long M) {
+        if (M > M_) {
+            M_ = M;
+            while (!rise_.empty() && rise_.top().m <= M_) {
+                Cert c = rise_.top(); rise_.pop();
+                if (still_flipped(c)) swap_cons(c.u, c.v);
+            }
+        } else if (M < M_) {
+            M_ = M;
+            while (!fall_.empty() && fall_.top().m >= M_) {
+                Cert c = fall_.top(); fall_.pop();
+                if (still_flipped(c)) swap_cons(c.u, c.v);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,455 @@
+/**
+ * @file inversions.hpp
+ * @brief Inversion counters (merge, Fenwick/BIT, quick-partition) used by rank_reliability.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * An inversion is a pair (i < j) with a[i] > a[j]. Equal values never count.
+ *
+ * Counters:
+ * - merge_count            : bottom-up merge sort, O(n log n), authoritative.
+ * - bit_count_inversions   : Fenwick tree sweep, O(n log n), authoritative (dense values
+ *                            index the tree directly; permutations use a bitmask + block tree).
+ * - quick_partition_count  : quicksort-style, diagnostic only (skips pairs with the pivot/ties).
+ *
+ * SSR: merge and BIT must agree; quick is there for intuition.
+ */
+#ifndef INVERSIONS_HPP
+#define INVERSIONS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief One branchless merge step: move the smaller head to @p out, count if right won.
+ *
+ * The "which side wins" bit selects the value, the inversion increment and both cursor
+ * moves, so there is no data-dependent jump (compiles to cmov/csel).
+ */
+template <class T>
+inline void merge_step(const T*& i, const T* m, const T*& j, T*& out, long long& inv) {
+    T x = *i, y = *j;
+    bool take_right = y < x;
+    *out++ = take_right ? y : x;
+    inv += (long long)(m - i) & -(long long)take_right;
+    i += !take_right;
+    j += take_right;
+}
+
+/**
+ * @brief Merge sorted runs [L, m) and [m, r) into @p out; returns cross inversions.
+ *
+ * A single branchless merge is one long dependency chain (load -> compare -> advance).
+ * So we cut the output in half with a merge-path binary search and run the two halves
+ * as independent streams in the same loop; the CPU overlaps them.
+ *
+ * Counting stays exact: a right element y always adds (m - i) = left elements still
+ * waiting, and the stable split guarantees every left element in the second half is > y.
+ */
+template <class T>
+inline long long merge_runs(const T* L, const T* m, const T* r, T* out) {
+    size_t nl = (size_t)(m - L), nr = (size_t)(r - m), k = (nl + nr) / 2;
+    // Smallest a such that the first k outputs are L[0..a) + R[0..k-a) (ties favour left).
+    size_t lo = k > nr ? k - nr : 0, hi = std::min(k, nl);
+    while (lo < hi) {
+        size_t a = (lo + hi) / 2;
+        if (!(m[k - a - 1] < L[a])) lo = a + 1; else hi = a;
+    }
+    const T *i1 = L, *e1 = L + lo, *j1 = m, *f1 = m + (k - lo);
+    const T *i2 = e1, *j2 = f1;
+    T* o1 = out;
+    T* o2 = out + k;
+    long long inv1 = 0, inv2 = 0;
+    while (i1 < e1 && j1 < f1 && i2 < m && j2 < r) {
+        merge_step(i1, m, j1, o1, inv1);
+        merge_step(i2, m, j2, o2, inv2);
+    }
+    while (i1 < e1 && j1 < f1) merge_step(i1, m, j1, o1, inv1);
+    while (i2 < m && j2 < r) merge_step(i2, m, j2, o2, inv2);
+    // Tails: leftover left elements add nothing; a leftover right element in the first
+    // half still sits before every left element of the second half.
+    while (i1 < e1) *o1++ = *i1++;
+    while (j1 < f1) { *o1++ = *j1++; inv1 += (long long)(m - i1); }
+    while (i2 < m) *o2++ = *i2++;
+    while (j2 < r) *o2++ = *j2++;
+    return inv1 + inv2;
+}
+
+// Base-case tile: small enough for insertion counting to stay in L1 and branch-predictable.
+constexpr size_t MERGE_TILE = 32;
+
+/**
+ * @brief Iterative merge-sort inversion kernel (no recursion, no allocation).
+ *
+ * How it works:
+ * 1) Cut the array into tiles of MERGE_TILE elements and insertion-sort each tile;
+ *    every shift of a larger element past x is exactly one inversion.
+ * 2) Bottom-up passes merge tiles of width 32, 64, 128, ... ping-ponging between
+ *    @p a and @p buf (merge_runs). If two neighbouring runs are already in order we just copy.
+ *
+ * @p a is sorted on return; @p buf must hold n elements (contents are scratch).
+ *
+ * SSR: insertion-count small tiles -> branchless bottom-up merges -> add (m − i) on every right win.
+ */
+template <class T>
+inline long long merge_count_blocked(T* a, T* buf, size_t n) {
+    long long inv = 0;
+    for (size_t l = 0; l < n; l += MERGE_TILE) {
+        size_t r = std::min(n, l + MERGE_TILE);
+        for (size_t i = l + 1; i < r; ++i) {
+            T x = a[i];
+            size_t j = i;
+            while (j > l && a[j - 1] > x) { a[j] = a[j - 1]; --j; }
+            a[j] = x;
+            inv += (long long)(i - j);
+        }
+    }
+
+    T* src = a;
+    T* dst = buf;
+    for (size_t width = MERGE_TILE; width < n; width *= 2) {
+        for (size_t l = 0; l < n; l += 2 * width) {
+            size_t m = std::min(n, l + width);
+            size_t r = std::min(n, l + 2 * width);
+            if (m >= r || !(src[m] < src[m - 1])) {
+                std::copy(src + l, src + r, dst + l);
+                continue;
+            }
+            inv += merge_runs(src + l, src + m, src + r, dst + l);
+        }
+        std::swap(src, dst);
+    }
+    if (src != a) std::copy(src, src + n, a);
+    return inv;
+}
+
+/**
+ * @brief Reusable buffers for merge_count(const vector&, MergeScratch&).
+ *
+ * Keep one per thread and pass it for every source: after the first (largest) source
+ * nothing is allocated any more.
+ */
+struct MergeScratch {
+    std::vector<uint32_t> a32, b32;
+    std::vector<long long> a64, b64;
+};
+
+/**
+ * @brief Inversion counter using merge sort (O(n log n)).
+ *
+ * Intuition:
+ * An inversion is a pair (i < j) where a[i] > a[j]. During the merge step,
+ * whenever a right-half element jumps ahead of the remaining left-half elements,
+ * it creates (m - i) inversions at once.
+ *
+ * Important:
+ * - Sorts @p a in place (same contract as before), one temp buffer of n elements.
+ * - Equal values are kept stable (no inversions added when a[i] == a[j]).
+ *
+ * SSR: divide & conquer; add (m − i) when right beats left in merge.
+ */
+inline long long merge_count(std::vector<long long>& a) {
+    std::vector<long long> tmp(a.size());
+    return merge_count_blocked(a.data(), tmp.data(), a.size());
+}
+
+/**
+ * @brief Same count as merge_count, but leaves @p a untouched and reuses @p sc.
+ *
+ * Position arrays hold values in [1..N], so when everything fits in 32 bits we
+ * narrow while copying and sort uint32_t: half the memory traffic per pass.
+ */
+inline long long merge_count(const std::vector<long long>& a, MergeScratch& sc) {
+    size_t n = a.size();
+    bool fits32 = true;
+    for (long long x : a) fits32 &= (unsigned long long)x <= 0xFFFFFFFFull;
+    if (fits32) {
+        if (sc.a32.size() < n) { sc.a32.resize(n); sc.b32.resize(n); }
+        for (size_t i = 0; i < n; ++i) sc.a32[i] = (uint32_t)a[i];
+        return merge_count_blocked(sc.a32.data(), sc.b32.data(), n);
+    }
+    if (sc.a64.size() < n) { sc.a64.resize(n); sc.b64.resize(n); }
+    std::copy(a.begin(), a.end(), sc.a64.begin());
+    return merge_count_blocked(sc.a64.data(), sc.b64.data(), n);
+}
+
+/**
+ * @brief Fenwick Tree (BIT) for prefix sums (point update, prefix query).
+ *
+ * Why here:
+ * - We use it to count “how many smaller elements have we seen so far” in O(log n),
+ *   which turns inversion counting into a right-to-left sweep.
+ *
+ * API:
+ *   BIT bit(n);      // 1-based size
+ *   bit.add(i, v);   // arr[i] += v
+ *   bit.sum(i);      // sum over [1..i]
+ *
+ * SSR: tiny tree array that gives prefix sums fast; perfect for inversions.
+ */
+struct BIT {
+    int n; std::vector<long long> f;
+    BIT(int n): n(n), f(n+1, 0) {}
+    void add(int i, long long v){ for(; i<=n; i+= i&-i) f[i] += v; }
+    long long sum(int i){ long long s=0; for(; i>0; i-= i&-i) s += f[i]; return s; }
+};
+
+/**
+ * @brief Reusable buffers for bit_count_inversions (one per thread).
+ */
+struct BitScratch {
+    std::vector<uint32_t> f32;   // Fenwick cells (32-bit while n < 2^32)
+    std::vector<long long> f64;  // Fenwick cells for huge n
+    std::vector<uint64_t> mask;  // permutation path: one presence bit per value
+    std::vector<uint32_t> rank;  // sparse path: compressed value per index
+    std::vector<uint64_t> keys, keys2;
+    std::vector<uint32_t> idx, idx2;
+};
+
+// Value range above which we compress instead of indexing the tree by value.
+constexpr size_t BIT_DENSE_FACTOR = 4;
+
+/**
+ * @brief Sparse values -> dense ranks 1..K in @p sc.rank, by LSD radix sort of (value, index).
+ *
+ * 16-bit digits, only as many passes as the value range needs; equal values get equal
+ * ranks. Linear time, sequential passes (no per-element binary search). Returns K.
+ */
+inline uint32_t compress_ranks(const std::vector<long long>& a, long long lo, unsigned long long range,
+                               BitScratch& sc) {
+    const size_t n = a.size();
+    sc.keys.resize(n); sc.keys2.resize(n); sc.idx.resize(n); sc.idx2.resize(n); sc.rank.resize(n);
+    for (size_t i = 0; i < n; ++i) { sc.keys[i] = (uint64_t)a[i] - (uint64_t)lo; sc.idx[i] = (uint32_t)i; }
+    // Keys lie in [0, range - 1]: sort on the bit length of range - 1 (range 0 = all 2^64 values).
+    const unsigned long long top = range - 1;
+    int bits = 0;
+    while (bits < 64 && (top >> bits) != 0) ++bits;
+    std::vector<size_t> count(1 << 16);
+    for (int shift = 0; shift < bits; shift += 16) {
+        std::fill(count.begin(), count.end(), 0);
+        for (size_t i = 0; i < n; ++i) ++count[(sc.keys[i] >> shift) & 0xFFFF];
+        size_t sum = 0;
+        for (auto& c : count) { size_t t = c; c = sum; sum += t; }
+        for (size_t i = 0; i < n; ++i) {
+            size_t d = count[(sc.keys[i] >> shift) & 0xFFFF]++;
+            sc.keys2[d] = sc.keys[i]; sc.idx2[d] = sc.idx[i];
+        }
+        sc.keys.swap(sc.keys2); sc.idx.swap(sc.idx2);
+    }
+    uint32_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i == 0 || sc.keys[i] != sc.keys[i - 1]) ++k;
+        sc.rank[sc.idx[i]] = k;
+    }
+    return k;
+}
+
+/**
+ * @brief Right-to-left Fenwick sweep over values 1..m (get(i) gives the value at i).
+ * C is the cell type; 32-bit cells halve the tree's footprint when n < 2^32.
+ */
+template <class C, class Get>
+inline long long fenwick_sweep(size_t n, size_t m, std::vector<C>& f, Get get) {
+    f.assign(m + 1, 0);
+    C* t = f.data();
+    long long inv = 0;
+    for (size_t i = n; i-- > 0;) {
+        size_t x = get(i);
+        long long s = 0;
+        for (size_t j = x - 1; j > 0; j &= j - 1) s += t[j];
+        inv += s;
+        for (size_t j = x; j <= m; j += j & (0 - j)) ++t[j];
+    }
+    return inv;
+}
+
+/**
+ * @brief Permutation path: presence bits per 64 values + a Fenwick tree over the blocks.
+ *
+ * "Seen values < x" = blocks before x's block (tree, 64x fewer cells than values) +
+ * popcount of the lower bits in x's own word. Returns false on a repeated value
+ * (then the input was not a permutation and the caller switches path).
+ */
+inline bool bitmask_sweep(const std::vector<long long>& a, long long lo, size_t m, BitScratch& sc,
+                          long long& inv) {
+    const size_t n = a.size(), nb = (m + 63) / 64;
+    sc.mask.assign(nb, 0);
+    sc.f32.assign(nb + 1, 0);
+    uint64_t* mask = sc.mask.data();
+    uint32_t* t = sc.f32.data();
+    inv = 0;
+    for (size_t i = n; i-- > 0;) {
+        size_t v = (size_t)(a[i] - lo), b = v >> 6;
+        uint64_t bit = (uint64_t)1 << (v & 63);
+        if (mask[b] & bit) return false;
+        long long s = __builtin_popcountll(mask[b] & (bit - 1));
+        for (size_t j = b; j > 0; j &= j - 1) s += t[j];
+        inv += s;
+        mask[b] |= bit;
+        for (size_t j = b + 1; j <= nb; j += j & (0 - j)) ++t[j];
+    }
+    return true;
+}
+
+/**
+ * @brief Inversion counter via BIT (Fenwick), picking the cheapest layout for the values.
+ *
+ * How it works:
+ * 1) One pass for min/max. Position arrays are dense (values in 1..N), so when the value
+ *    range is at most BIT_DENSE_FACTOR * n the tree is indexed by value directly: no
+ *    compression, no sort.
+ * 2) Range == n (a permutation candidate): presence bitmask + block tree (bitmask_sweep).
+ *    Otherwise a Fenwick tree with 32-bit cells (64-bit only past 2^32 elements).
+ * 3) Sparse values: compress_ranks (radix, linear) first, then the same sweep over 1..K.
+ * Each step: inv += (seen values < x); then mark x. Equal values never count.
+ *
+ * Complexity: O(n log m) time (m = tree size), O(m) memory, all buffers in @p sc.
+ *
+ * SSR: min/max -> (dense: index by value | sparse: radix ranks) -> sweep right-to-left with prefix sums.
+ */
+inline long long bit_count_inversions(const std::vector<long long>& a, BitScratch& sc){
+    const size_t n = a.size();
+    if (n < 2) return 0;
+    auto mm = std::minmax_element(a.begin(), a.end());
+    const long long lo = *mm.first;
+    // Unsigned: max - min overflows long long for spread-out values; range 0 = wrapped (2^64 values).
+    const unsigned long long range = (unsigned long long)*mm.second - (unsigned long long)lo + 1;
+    const bool wide = n >= ((size_t)1 << 32);
+    long long inv = 0;
+    if (range != 0 && range <= (unsigned long long)n * BIT_DENSE_FACTOR) {
+        const size_t m = (size_t)range;
+        if (m == n && !wide && bitmask_sweep(a, lo, m, sc, inv)) return inv;
+        auto get = [&](size_t i){ return (size_t)(a[i] - lo) + 1; };
+        return wide ? fenwick_sweep(n, m, sc.f64, get) : fenwick_sweep(n, m, sc.f32, get);
+    }
+    if (wide) { // ranks past 2^32 do not fit the uint32 rank array: plain sort + search
+        std::vector<long long> v(a);
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+        return fenwick_sweep(n, v.size(), sc.f64, [&](size_t i){
+            return (size_t)(std::lower_bound(v.begin(), v.end(), a[i]) - v.begin()) + 1;
+        });
+    }
+    uint32_t k = compress_ranks(a, lo, range, sc);
+    return fenwick_sweep(n, k, sc.f32, [&](size_t i){ return (size_t)sc.rank[i]; });
+}
+
+inline long long bit_count_inversions(const std::vector<long long>& a){
+    BitScratch sc;
+    return bit_count_inversions(a, sc);
+}
+
+/**
+ * @brief Reusable buffers for the quick-partition diagnostic.
+ *
+ * Two n-sized ping-pong arrays plus the explicit segment stack; like MergeScratch,
+ * one per thread means no allocation after the largest source.
+ */
+struct QuickScratch {
+    struct Seg { size_t l, r; bool in_b; };
+    std::vector<long long> a, b;
+    std::vector<Seg> stack;
+};
+
+/**
+ * @brief Quicksort-style “count while partitioning” (diagnostic).
+ *
+ * What are we doing:
+ * - Pick a pivot; scan once. Every time we see a smaller-than-pivot after a greater-than-pivot,
+ *   that’s a cross-inversion. We count those, then recurse on <pivot and >pivot buckets.
+ *
+ * When to trust:
+ * - Great for intuition and sanity checks, but merge/BIT are our ground truth.
+ * - Duplicates are treated as equal (no inversions among ties).
+ *
+ * No allocation per level:
+ * - The pivot is the middle of each bucket in its original order, so buckets must stay
+ *   stable (that is what makes the count the same as the old vector-per-level version).
+ * - A segment [l, r) is counted in one pass, then scattered stably into the other buffer:
+ *   <pivot to [l, l+nl), >pivot to [r-ng, r), ties dropped. Children keep their range,
+ *   so the two buffers ping-pong without overlap. Segments go on an explicit stack.
+ *
+ * SSR: pivot -> count “greater-before-smaller” during partition -> recurse.
+ */
+inline long long quick_partition_count(const std::vector<long long>& a, QuickScratch& sc){
+    const size_t n = a.size();
+    if (n <= 1) return 0;
+    if (sc.a.size() < n) { sc.a.resize(n); sc.b.resize(n); }
+    std::copy(a.begin(), a.end(), sc.a.begin());
+    sc.stack.clear();
+    sc.stack.push_back({0, n, false});
+    long long inv = 0;
+    while (!sc.stack.empty()) {
+        QuickScratch::Seg seg = sc.stack.back();
+        sc.stack.pop_back();
+        const long long* src = (seg.in_b ? sc.b : sc.a).data();
+        long long* dst = (seg.in_b ? sc.a : sc.b).data();
+        const long long pivot = src[seg.l + (seg.r - seg.l) / 2];
+
+        size_t nl = 0, ng = 0;
+        for (size_t i = seg.l; i < seg.r; ++i) {
+            if (src[i] > pivot) ++ng;
+            else if (src[i] < pivot) { ++nl; inv += (long long)ng; }
+        }
+        size_t lo = seg.l, hi = seg.r - ng;
+        for (size_t i = seg.l; i < seg.r; ++i) {
+            if (src[i] < pivot) dst[lo++] = src[i];
+            else if (src[i] > pivot) dst[hi++] = src[i];
+        }
+        if (nl > 1) sc.stack.push_back({seg.l, seg.l + nl, !seg.in_b});
+        if (ng > 1) sc.stack.push_back({seg.r - ng, seg.r, !seg.in_b});
+    }
+    return inv;
+}
+
+inline long long quick_partition_count(const std::vector<long long>& a){
+    QuickScratch sc;
+    return quick_partition_count(a, sc);
+}
+
+/**
+ * @brief Per-thread buffers for every counter (see counter_engine.hpp).
+ */
+struct CounterScratch {
+    MergeScratch merge;
+    BitScratch bit;
+    QuickScratch quick;
+};
+
+/**
+ * @brief Run all three counters on the same array for cross-checking.
+ *
+ * Why:
+ * - merge_count and BIT should match exactly (both O(n log n)).
+ * - quick_partition_count is included as a learning/diagnostic baseline.
+ *
+ * Every counter works in @p cs (per-thread scratch), so @p arr is never copied.
+ * If @p t is given, each counter's wall time lands there (--profile).
+ *
+ * SSR: run merge, BIT, quick on the same array -> compare.
+ */
+struct InvTriple { long long merge_inv, bit_inv, quick_inv; };
+struct CounterTimes { long long merge_ns = 0, bit_ns = 0, quick_ns = 0; };
+inline InvTriple three_way_inv(const std::vector<long long>& arr, CounterScratch& cs,
+                               CounterTimes* t = nullptr){
+    using clk = std::chrono::steady_clock;
+    auto ns = [](clk::time_point a, clk::time_point b){
+        return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+    };
+    clk::time_point t0 = t ? clk::now() : clk::time_point();
+    long long m = merge_count(arr, cs.merge);
+    clk::time_point t1 = t ? clk::now() : clk::time_point();
+    long long b = bit_count_inversions(arr, cs.bit);
+    clk::time_point t2 = t ? clk::now() : clk::time_point();
+    long long q = quick_partition_count(arr, cs.quick);
+    if (t) {
+        clk::time_point t3 = clk::now();
+        t->merge_ns = ns(t0, t1); t->bit_ns = ns(t1, t2); t->quick_ns = ns(t2, t3);
+    }
+    return {m,b,q};
+}
+
+#endif
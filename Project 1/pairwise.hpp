@@ -0,0 +1,119 @@
+/**
+ * @file pairwise.hpp
+ * @brief All-pairs source-to-source Kendall distance (S x S inversion counts).
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * What we compute:
+ * - Every source becomes a full permutation of the N consensus positions: the items it
+ *   lists (by rank, i.e. last occurrence, same as the rank matrix), then the items it
+ *   misses in consensus order (same tail rule as the position arrays).
+ * - d(s, t) = number of item pairs that s and t order differently
+ *           = inversions of pos_t[order_s[0..N)]  (t's positions read in s's order).
+ *
+ * How we keep S^2 kernels affordable:
+ * - Symmetry: d(s, t) = d(t, s) and d(s, s) = 0, so only s < t runs (S(S-1)/2 kernels).
+ * - Tiles of PAIR_TILE x PAIR_TILE sources are the pool tasks. A task builds the position
+ *   rows of its (up to) PAIR_TILE t-sources once and reuses them for every s, so they stay
+ *   in cache.
+ * - Rows come from the engine's combined positions (ReliabilityEngine::combined_positions)
+ *   and the ID lists; no S x N table is ever built. A worker holds PAIR_TILE + 4 uint32
+ *   rows of N, and rebuilding a row (O(N)) is cheap next to the O(N log N) kernels.
+ * - The kernel is the allocation-free merge_count_blocked from inversions.hpp.
+ *
+ * SSR: per tile: t rows -> per s: order row -> gather t's positions in s's order -> merge-count -> mirror.
+ */
+#ifndef PAIRWISE_HPP
+#define PAIRWISE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "inversions.hpp"
+#include "work_pool.hpp"
+
+// Sources per tile side; 8 x 8 pairs per pool task.
+constexpr size_t PAIR_TILE = 8;
+
+/**
+ * @brief Full ranking of one source as 0-based consensus positions.
+ *
+ * The items it lists by rank (last occurrence wins, like the rank matrix), then the
+ * positions it misses in consensus order. @p seen (N entries) must hold no @p stamp yet.
+ *
+ * @param combined_pos item ID -> 1-based consensus position (size N = universe)
+ */
+inline void source_order(const std::vector<uint32_t>& l, const std::vector<uint32_t>& combined_pos,
+                         std::vector<uint32_t>& seen, uint32_t stamp, uint32_t* ord) {
+    const size_t N = combined_pos.size();
+    // Walk backwards so the last occurrence is the one kept, then flip.
+    size_t k = 0;
+    for (size_t i = l.size(); i-- > 0;) {
+        uint32_t c = combined_pos[l[i]] - 1;
+        if (seen[c] == stamp) continue;
+        seen[c] = stamp;
+        ord[k++] = c;
+    }
+    std::reverse(ord, ord + k);
+    for (uint32_t c = 0; c < N; ++c) if (seen[c] != stamp) ord[k++] = c;
+}
+
+/**
+ * @brief S x S Kendall distances (row-major, symmetric, zero diagonal).
+ *
+ * Tasks are the upper-triangle tiles (bi <= bj); each worker builds rows into its own
+ * buffers and writes both d[s][t] and d[t][s], so no two tasks touch the same cell.
+ *
+ * @param src_items    per-source item IDs (duplicates allowed; the last occurrence wins)
+ * @param combined_pos item ID -> 1-based consensus position, e.g. the engine's
+ */
+inline std::vector<long long> pairwise_kendall(const std::vector<std::vector<uint32_t>>& src_items,
+                                               const std::vector<uint32_t>& combined_pos,
+                                               WorkStealingPool& pool) {
+    const size_t S = src_items.size(), N = combined_pos.size();
+    std::vector<long long> d(S * S, 0);
+    const size_t tiles = (S + PAIR_TILE - 1) / PAIR_TILE;
+    std::vector<std::pair<uint32_t, uint32_t>> tasks;
+    for (size_t bi = 0; bi < tiles; ++bi)
+        for (size_t bj = bi; bj < tiles; ++bj) tasks.push_back({(uint32_t)bi, (uint32_t)bj});
+
+    // pos: PAIR_TILE rows, pos[j*N + c] = where consensus position c sits in t0+j's ranking.
+    struct Scratch { std::vector<uint32_t> pos, ord, seen, a, b; uint32_t stamp = 0; };
+    std::vector<Scratch> scratch(pool.size());
+    pool.run(tasks.size(), [&](int w, size_t task){
+        Scratch& sc = scratch[w];
+        const size_t rows = std::min(S, PAIR_TILE);
+        if (sc.ord.size() < N) {
+            sc.pos.resize(rows * N); sc.ord.resize(N); sc.a.resize(N); sc.b.resize(N);
+            sc.seen.assign(N, 0);
+        }
+        auto build_order = [&](size_t s){
+            if (++sc.stamp == 0) { std::fill(sc.seen.begin(), sc.seen.end(), 0); sc.stamp = 1; }
+            source_order(src_items[s], combined_pos, sc.seen, sc.stamp, sc.ord.data());
+        };
+        const size_t s0 = tasks[task].first * PAIR_TILE, t0 = tasks[task].second * PAIR_TILE;
+        const size_t t1 = std::min(S, t0 + PAIR_TILE);
+        for (size_t t = t0; t < t1; ++t) {
+            build_order(t);
+            uint32_t* pt = sc.pos.data() + (t - t0) * N;
+            for (size_t i = 0; i < N; ++i) pt[sc.ord[i]] = (uint32_t)i;
+        }
+        for (size_t s = s0; s < std::min(S, s0 + PAIR_TILE); ++s) {
+            if (std::max(t0, s + 1) >= t1) continue;
+            build_order(s);
+            for (size_t t = std::max(t0, s + 1); t < t1; ++t) {
+                const uint32_t* pt = sc.pos.data() + (t - t0) * N;
+                for (size_t k = 0; k < N; ++k) sc.a[k] = pt[sc.ord[k]];
+                long long inv = merge_count_blocked(sc.a.data(), sc.b.data(), N);
+                d[s * S + t] = inv;
+                d[t * S + s] = inv;
+            }
+        }
+    });
+    return d;
+}
+
+#endif
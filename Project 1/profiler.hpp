@@ -0,0 +1,262 @@
+/**
+ * @file profiler.hpp
+ * @brief --profile FILE: wall/CPU time, I/O bytes, allocations and peak RSS per phase and per source.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * What is measured:
+ * - Phases (main thread, whole process): wall time, process CPU time (all threads),
+ *   bytes read from sources/cache, bytes handed to the writer, operator new calls/bytes,
+ *   and peak RSS. VmHWM is reset at every phase start (/proc/self/clear_refs), so each
+ *   phase gets its own peak where the kernel allows it.
+ * - Sources (one span for loading, one for counting): wall time, CPU time of the thread
+ *   that ran it, and that thread's allocations. Workers run sources concurrently, so
+ *   per-source RSS would be meaningless and is not reported.
+ * - Inside three_way_inv, each counter is timed separately (CounterTimes).
+ *
+ * Allocations are counted by the operator new replacement in rank_reliability.cpp, and only
+ * while prof_track_allocs is set (it is set before any worker starts). Without --profile
+ * nothing here runs except that one flag test per allocation.
+ *
+ * SSR: snapshot clocks + counters at start -> subtract at stop -> one JSON document at exit.
+ */
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include "inversions.hpp"
+#include "report_writer.hpp"
+
+// ---- Allocation tally -------------------------------------------------------
+inline bool prof_track_allocs = false;
+inline std::atomic<long long> prof_allocs{0}, prof_alloc_bytes{0};
+struct AllocTally { long long count, bytes; };
+inline thread_local AllocTally prof_thread_allocs{0, 0}; // trivial: no allocation on first use
+
+inline void prof_note_alloc(size_t n) {
+    if (!prof_track_allocs) return;
+    prof_allocs.fetch_add(1, std::memory_order_relaxed);
+    prof_alloc_bytes.fetch_add((long long)n, std::memory_order_relaxed);
+    ++prof_thread_allocs.count;
+    prof_thread_allocs.bytes += (long long)n;
+}
+
+// ---- Clocks and memory ------------------------------------------------------
+inline long long prof_wall_ns() {
+    return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline long long prof_cpu_ns(clockid_t clk) {
+    timespec ts;
+    if (clock_gettime(clk, &ts) != 0) return 0;
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// VmHWM in KiB (stdio only, so reading it allocates nothing); ru_maxrss if /proc is missing.
+inline long long prof_peak_rss_kb() {
+    if (std::FILE* f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        long long kb = -1;
+        while (std::fgets(line, sizeof line, f))
+            if (std::strncmp(line, "VmHWM:", 6) == 0) { kb = std::atoll(line + 6); break; }
+        std::fclose(f);
+        if (kb >= 0) return kb;
+    }
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (long long)ru.ru_maxrss;
+}
+
+// Writing "5" resets VmHWM to the current RSS (Linux >= 4.0); harmless if it fails.
+inline void prof_reset_peak_rss() {
+    if (std::FILE* f = std::fopen("/proc/self/clear_refs", "w")) {
+        std::fputs("5", f);
+        std::fclose(f);
+    }
+}
+
+struct ProfStats {
+    long long wall_ns = 0, cpu_ns = 0;
+    long long bytes_read = 0, bytes_written = 0;
+    long long allocs = 0, alloc_bytes = 0;
+    long long peak_rss_kb = -1; // phases only
+};
+
+/**
+ * @brief Start/stop snapshot for one thread's work (a source being loaded or counted).
+ */
+class ProfSpan {
+public:
+    void start() {
+        wall_ = prof_wall_ns();
+        cpu_ = prof_cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+        tally_ = prof_thread_allocs;
+    }
+    ProfStats stop(long long bytes_read, long long bytes_written) const {
+        ProfStats st;
+        st.wall_ns = prof_wall_ns() - wall_;
+        st.cpu_ns = prof_cpu_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_;
+        st.allocs = prof_thread_allocs.count - tally_.count;
+        st.alloc_bytes = prof_thread_allocs.bytes - tally_.bytes;
+        st.bytes_read = bytes_read;
+        st.bytes_written = bytes_written;
+        return st;
+    }
+private:
+    long long wall_ = 0, cpu_ = 0;
+    AllocTally tally_{0, 0};
+};
+
+/**
+ * @brief Phase timeline + per-source records; write() emits the JSON.
+ *
+ * Usage:
+ *   Profiler prof;
+ *   prof.enable([&]{ return writer.bytes_queued(); });
+ *   prof.phase("parse"); ... prof.phase("consensus"); ... prof.end();
+ */
+class Profiler {
+public:
+    struct Source {
+        std::string name;
+        long long n = 0;
+        ProfStats load, count;
+        bool three_way = false;
+        CounterTimes times;          // three_way_inv counters
+        const char* engine = nullptr; // counter that produced inv when three_way is false
+        long long engine_ns = 0;
+    };
+
+    // @p written reports the bytes handed to the output writer so far.
+    void enable(std::function<unsigned long long()> written) {
+        on_ = true;
+        written_ = std::move(written);
+        prof_track_allocs = true;
+        start_wall_ = prof_wall_ns();
+        start_cpu_ = prof_cpu_ns(CLOCK_PROCESS_CPUTIME_ID);
+    }
+    bool on() const { return on_; }
+
+    // Closes the open phase (if any) and starts @p name.
+    void phase(const char* name) {
+        if (!on_) return;
+        end();
+        open_ = true;
+        cur_.name = name;
+        cur_.start = snapshot();
+        prof_reset_peak_rss();
+    }
+
+    void end() {
+        if (!on_ || !open_) return;
+        Snapshot now = snapshot();
+        ProfStats st;
+        st.wall_ns = now.wall - cur_.start.wall;
+        st.cpu_ns = now.cpu - cur_.start.cpu;
+        st.bytes_read = now.read - cur_.start.read;
+        st.bytes_written = now.written - cur_.start.written;
+        st.allocs = now.allocs - cur_.start.allocs;
+        st.alloc_bytes = now.alloc_bytes - cur_.start.alloc_bytes;
+        st.peak_rss_kb = prof_peak_rss_kb();
+        phases_.push_back({cur_.name, st});
+        open_ = false;
+    }
+
+    void add_read(long long bytes) { read_.fetch_add(bytes, std::memory_order_relaxed); }
+
+    std::vector<Source> sources;
+
+    void write(OutBuffer& out, int threads) {
+        end();
+        out << "{\n  \"threads\": " << threads << ",\n  \"total\": {";
+        ProfStats total;
+        total.wall_ns = prof_wall_ns() - start_wall_;
+        total.cpu_ns = prof_cpu_ns(CLOCK_PROCESS_CPUTIME_ID) - start_cpu_;
+        total.bytes_read = read_.load();
+        total.bytes_written = (long long)written_();
+        total.allocs = prof_allocs.load();
+        total.alloc_bytes = prof_alloc_bytes.load();
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        total.peak_rss_kb = (long long)ru.ru_maxrss; // never reset
+        put_stats(out, total);
+        out << "},\n  \"phases\": [";
+        for (size_t i = 0; i < phases_.size(); ++i) {
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << phases_[i].name << "\", ";
+            put_stats(out, phases_[i].st);
+            out << "}";
+        }
+        out << "\n  ],\n  \"sources\": [";
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const Source& s = sources[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"";
+            put_escaped(out, s.name);
+            out << "\", \"n\": " << s.n << ",\n     \"load\": {";
+            put_stats(out, s.load);
+            out << "},\n     \"count\": {";
+            put_stats(out, s.count);
+            out << "},\n     \"counters\": {";
+            if (s.three_way)
+                out << "\"merge_ms\": " << ms(s.times.merge_ns) << ", \"bit_ms\": " << ms(s.times.bit_ns)
+                    << ", \"quick_ms\": " << ms(s.times.quick_ns);
+            else if (s.engine)
+                out << "\"" << s.engine << "_ms\": " << ms(s.engine_ns);
+            out << "}}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    struct Snapshot { long long wall, cpu, read, written, allocs, alloc_bytes; };
+    struct Phase { std::string name; ProfStats st; };
+    struct Open { std::string name; Snapshot start; };
+
+    bool on_ = false, open_ = false;
+    std::function<unsigned long long()> written_;
+    long long start_wall_ = 0, start_cpu_ = 0;
+    std::atomic<long long> read_{0};
+    Open cur_;
+    std::vector<Phase> phases_;
+
+    Snapshot snapshot() const {
+        return {prof_wall_ns(), prof_cpu_ns(CLOCK_PROCESS_CPUTIME_ID), read_.load(),
+                (long long)written_(), prof_allocs.load(), prof_alloc_bytes.load()};
+    }
+
+    static OutBuffer::Fixed ms(long long ns) { return fixed_point((double)ns / 1e6, 3); }
+
+    static void put_stats(OutBuffer& out, const ProfStats& st) {
+        out << "\"wall_ms\": " << ms(st.wall_ns) << ", \"cpu_ms\": " << ms(st.cpu_ns)
+            << ", \"bytes_read\": " << st.bytes_read << ", \"bytes_written\": " << st.bytes_written
+            << ", \"allocs\": " << st.allocs << ", \"alloc_bytes\": " << st.alloc_bytes;
+        if (st.peak_rss_kb >= 0) out << ", \"peak_rss_kb\": " << st.peak_rss_kb;
+    }
+
+    static void put_escaped(OutBuffer& out, std::string_view s) {
+        for (char c : s) {
+            if (c == '"' || c == '\\') { out << '\\' << c; }
+            else if ((unsigned char)c < 0x20) {
+                char tmp[8];
+                std::snprintf(tmp, sizeof tmp, "\\u%04x", (unsigned)(unsigned char)c);
+                out << tmp;
+            } else out << c;
+        }
+    }
+};
+
+#endif
@@ -20,175 +20,298 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstdint>
 #include <filesystem>
-#include <functional>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <map>
-#include <set>
+#include <new>
 #include <sstream>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <system_error>
 
+#include <unistd.h>
+
+#include "counter_engine.hpp"
+#include "incremental.hpp"
+#include "pairwise.hpp"
+#include "profiler.hpp"
+#include "ranking_cache.hpp"
+#include "reliability.hpp"
+#include "report_writer.hpp"
+#include "source_loader.hpp"
+#include "work_pool.hpp"
+
 using namespace std;
 using ll = long long;
 
-/**
- * @brief Inversion counter using merge sort (O(n log n)).
- *
- * Intuition:
- * An inversion is a pair (i < j) where a[i] > a[j]. During the merge step,
- * whenever a right-half element jumps ahead of the remaining left-half elements,
- * it creates (m - i) inversions at once.
- *
- * Important:
- * - We reuse a single temp buffer and write the sorted range back into @p a.
- * - Equal values are kept stable (no inversions added when a[i] == a[j]).
- *
- * SSR: divide & conquer; add (m − i) when right beats left in merge.
- */
-static long long merge_count(vector<long long>& a) {
-    int n = (int)a.size();
-    vector<long long> tmp(n);
-    function<long long(int,int)> rec = [&](int l, int r)->long long {
-        if (r - l <= 1) return 0;
-        int m = (l + r) >> 1;
-        long long inv = rec(l, m) + rec(m, r);
-        int i = l, j = m, k = l;
-        while (i < m && j < r) {
-            if (a[i] <= a[j]) tmp[k++] = a[i++];
-            else { tmp[k++] = a[j++]; inv += (m - i); }
-        }
-        while (i < m) tmp[k++] = a[i++];
-        while (j < r) tmp[k++] = a[j++];
-        for (int t = l; t < r; ++t) a[t] = tmp[t];
-        return inv;
-    };
-    return rec(0, n);
+// ---- Allocation counting for --profile (one flag test per call when it is off) ----
+static void* counted_new(size_t n) {
+    prof_note_alloc(n);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
 }
+void* operator new(size_t n) { return counted_new(n); }
+void* operator new[](size_t n) { return counted_new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
 
 /**
- * @brief Fenwick Tree (BIT) for prefix sums (point update, prefix query).
- *
- * Why here:
- * - We use it to count “how many smaller elements have we seen so far” in O(log n),
- *   which turns inversion counting into a right-to-left sweep.
- *
- * API:
- *   BIT bit(n);      // 1-based size
- *   bit.add(i, v);   // arr[i] += v
- *   bit.sum(i);      // sum over [1..i]
- *
- * SSR: tiny tree array that gives prefix sums fast; perfect for inversions.
- */
-struct BIT {
-    int n; vector<long long> f;
-    BIT(int n): n(n), f(n+1, 0) {}
-    void add(int i, long long v){ for(; i<=n; i+= i&-i) f[i] += v; }
-    long long sum(int i){ long long s=0; for(; i>0; i-= i&-i) s += f[i]; return s; }
-};
-
-/**
- * @brief Inversion counter via BIT (Fenwick) with coordinate compression.
- *
- * How it works:
- * 1) Compress values into [1..K] so we can index the BIT.
- * 2) Scan from right to left; for value x, add how many seen values are < x:
- *      inv += bit.sum(rank(x) - 1);
- *    then mark x as seen: bit.add(rank(x), 1).
+ * @brief --incremental: keep consensus + inversions live while deltas arrive on stdin.
  *
- * Complexity: O(n log n) time, O(n) memory.
+ * Commands (one per line; <source> is a file name or a 1-based index):
+ *   append <source> <item>        item joins the end of the source
+ *   move <source> <pos> <item>    item moves to 1-based position pos
+ *   remove <source> <item>        item leaves the source
+ *   report                        CSV: source,n,inv,max_inv,reliability
+ *   top K                         first K consensus items with their sums
+ *   verify                        recompute from scratch and compare (debug)
  *
- * SSR: compress -> sweep right-to-left -> use BIT prefix sums to add “smaller-seen” counts.
+ * Replies go to stdout ("ok" / CSV / "error: ..."); stdout is flushed after every command.
  */
-static long long bit_count_inversions(vector<long long> a){
-    // coordinate compress
-    vector<long long> v = a;
-    sort(v.begin(), v.end());
-    v.erase(unique(v.begin(), v.end()), v.end());
-    vector<int> comp(a.size());
-    for(size_t i=0;i<a.size();++i){
-        comp[i] = int(lower_bound(v.begin(), v.end(), a[i]) - v.begin()) + 1; // 1-based
+static int run_incremental(ItemInterner& items, vector<vector<uint32_t>>& src_items,
+                           const vector<string>& src_names){
+    // One slot per item: keep the last occurrence, the one the batch ranks use.
+    vector<uint32_t> seen(items.size(), 0);
+    for (size_t s = 0; s < src_items.size(); ++s){
+        auto& l = src_items[s];
+        size_t w = l.size(); // kept items fill l[w..) back to front
+        for (size_t i = l.size(); i-- > 0;){
+            uint32_t id = l[i];
+            if (seen[id] != s + 1) { seen[id] = (uint32_t)s + 1; l[--w] = id; }
+        }
+        if (w != 0){
+            cerr << "[WARN] " << src_names[s] << ": dropped " << w
+                 << " duplicate line(s) for incremental mode\n";
+            l.erase(l.begin(), l.begin() + (ptrdiff_t)w);
+        }
     }
-    BIT bit((int)v.size());
-    long long inv = 0;
-    // traverse from right to left
-    for(int i=(int)comp.size()-1;i>=0;--i){
-        inv += bit.sum(comp[i]-1);
-        bit.add(comp[i], 1);
+
+    IncrementalConsensus ic(items, src_items);
+    auto source_index = [&](const string& tok)->int{
+        for (size_t s = 0; s < src_names.size(); ++s) if (src_names[s] == tok) return (int)s;
+        char* end = nullptr;
+        long v = strtol(tok.c_str(), &end, 10);
+        if (!tok.empty() && *end == '\0' && v >= 1 && v <= (long)src_names.size()) return (int)v - 1;
+        return -1;
+    };
+    // Rest of the line after the current token (items may contain spaces).
+    auto rest = [](istringstream& in){
+        string r;
+        getline(in >> std::ws, r);
+        if (!r.empty() && r.back() == '\r') r.pop_back();
+        return r;
+    };
+
+    string line;
+    while (getline(cin, line)){
+        istringstream in(line);
+        string cmd;
+        if (!(in >> cmd)) continue;
+        string err;
+        if (cmd == "append" || cmd == "move" || cmd == "remove"){
+            string tok; in >> tok;
+            int s = source_index(tok);
+            size_t pos = 0;
+            if (cmd == "move" && !(in >> pos)) err = "move needs a position";
+            string item = rest(in);
+            if (err.empty() && s < 0) err = "unknown source " + tok;
+            if (err.empty() && item.empty()) err = "missing item";
+            if (err.empty()){
+                if (cmd == "append") err = ic.append(s, item);
+                else if (cmd == "move") err = ic.move(s, item, pos);
+                else err = ic.remove(s, item);
+            }
+            if (err.empty()) cout << "ok\n";
+        } else if (cmd == "report"){
+            long long max_inv = ic.max_inversions();
+            cout << "source,n,inv,max_inv,reliability\n" << std::fixed << setprecision(6);
+            for (int s = 0; s < ic.sources(); ++s){
+                double rel = max_inv > 0 ? 1.0 - (double)ic.inversions(s) / (double)max_inv : 1.0;
+                cout << src_names[s] << "," << ic.universe() << "," << ic.inversions(s) << ","
+                     << max_inv << "," << rel << "\n";
+            }
+        } else if (cmd == "top"){
+            size_t k = 10; in >> k;
+            vector<uint32_t> order = ic.consensus();
+            for (size_t i = 0; i < order.size() && i < k; ++i)
+                cout << (i+1) << "," << items.view(order[i]) << "," << ic.borda_sum(order[i]) << "\n";
+        } else if (cmd == "verify"){
+            err = ic.verify();
+            if (err.empty()) cout << "ok\n";
+        } else {
+            err = "unknown command " + cmd;
+        }
+        if (!err.empty()) cout << "error: " << err << "\n";
+        cout.flush();
     }
-    return inv;
+    return 0;
 }
 
 /**
- * @brief Quicksort-style “count while partitioning” (diagnostic).
+ * @brief --serve: run many small jobs from stdin on one warm ReliabilityEngine.
  *
- * What are we doing:
- * - Pick a pivot; scan once. Every time we see a smaller-than-pivot after a greater-than-pivot,
- *   that’s a cross-inversion. We count those, then recurse on <pivot and >pivot buckets.
+ * The pool threads, per-worker scratch, interner and ID lists are kept across jobs, and
+ * nothing touches the filesystem. A job:
+ *   job [counter=MODE] [consensus=borda|kemeny-local] [kemeny-window=W] [approx=EPS]
+ *       [bootstrap=B] [top=K]
+ *   source <name> <count>         followed by <count> item lines, best first
+ *   ...                           (one block per source)
+ *   run                           compute and reply
+ * quit ends the session.
  *
- * When to trust:
- * - Great for intuition and sanity checks, but merge/BIT are our ground truth.
- * - Duplicates are treated as equal (no inversions among ties).
- *
- * SSR: pivot -> count “greater-before-smaller” during partition -> recurse.
+ * Reply to run (stdout, flushed):
+ *   result <job> sources=S items=N ms=T
+ *   the inversions_summary.csv header and rows (interval columns with approx/bootstrap)
+ *   position,item,sum_rank,avg_rank + the first K consensus items (top=K only)
+ *   end
+ * A bad line gets "error: ..." and drops the current job. Counter notes go to stderr.
  */
-static long long quick_partition_count(const vector<long long>& a){
-    function<long long(int,int)> rec = [&](int l, int r)->long long{
-        if (r - l <= 1) return 0;
-        int n = r - l;
-        long long pivot = a[l + n/2];
-
-        vector<long long> less;    less.reserve(n);
-        vector<long long> equal;   equal.reserve(n);
-        vector<long long> greater; greater.reserve(n);
-        long long seen_greater = 0;
-        long long cross = 0;
-        for (int i=l;i<r;++i){
-            if (a[i] > pivot){ greater.push_back(a[i]); seen_greater++; }
-            else if (a[i] < pivot){ less.push_back(a[i]); cross += seen_greater; }
-            else { equal.push_back(a[i]); }
-        }
-
-        long long inv = cross;
-        if (!less.empty())    inv += quick_partition_count(less);
-        if (!greater.empty()) inv += quick_partition_count(greater);
-        return inv;
+static int run_serve(int threads, bool quiet){
+    ReliabilityEngine engine(threads);
+    ItemInterner items;
+    vector<vector<uint32_t>> src_items, spare; // spare: cleared lists of earlier jobs
+    vector<string> src_names;
+    ReliabilityOptions opt;
+    size_t top = 0;
+    bool open_job = false;
+    long long jobs = 0;
+
+    string line;
+    auto next_line = [&]()->bool{
+        if (!getline(cin, line)) return false;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    };
+    auto fail = [&](const string& err){
+        cout << "error: " << err << "\n";
+        cout.flush();
+        open_job = false;
     };
-    return rec(0, (int)a.size());
-}
 
-/**
- * @brief Run all three counters on the same array for cross-checking.
- *
- * Why:
- * - merge_count and BIT should match exactly (both O(n log n)).
- * - quick_partition_count is included as a learning/diagnostic baseline.
- *
- * SSR: copy -> run merge, BIT, quick -> compare.
- */
-struct InvTriple { long long merge_inv, bit_inv, quick_inv; };
-static InvTriple three_way_inv(vector<long long> arr){
-    vector<long long> a1 = arr;
-    vector<long long> a2 = arr;
-    vector<long long> a3 = arr;
-    long long m = merge_count(a1);
-    long long b = bit_count_inversions(a2);
-    long long q = quick_partition_count(a3);
-    return {m,b,q};
+    while (next_line()){
+        istringstream in(line);
+        string cmd;
+        if (!(in >> cmd)) continue;
+        if (cmd == "quit") break;
+        if (cmd == "job"){
+            items.clear();
+            for (auto& l : src_items) { l.clear(); spare.push_back(std::move(l)); }
+            src_items.clear();
+            src_names.clear();
+            opt = ReliabilityOptions();
+            opt.quiet = quiet;
+            top = 0;
+            open_job = true;
+            string kv, err;
+            while (err.empty() && in >> kv){
+                size_t eq = kv.find('=');
+                string key = kv.substr(0, eq), val = eq == string::npos ? "" : kv.substr(eq + 1);
+                if (key == "counter" && (val == "all" || val == "auto" || val == "verify" || val == "merge" || val == "bit"))
+                    opt.counter = val;
+                else if (key == "consensus" && (val == "borda" || val == "kemeny-local"))
+                    opt.kemeny = val == "kemeny-local";
+                else if (key == "kemeny-window") opt.kemeny_window = max(1, atoi(val.c_str()));
+                else if (key == "approx" && atof(val.c_str()) > 0 && atof(val.c_str()) < 1)
+                    opt.approx_eps = atof(val.c_str());
+                else if (key == "bootstrap" && atoi(val.c_str()) >= 2) opt.bootstrap = atoi(val.c_str());
+                else if (key == "top") top = (size_t)max(0, atoi(val.c_str()));
+                else err = "bad job option " + kv;
+            }
+            if (err.empty() && opt.approx_eps > 0 && opt.bootstrap) err = "approx already reports an interval; drop bootstrap";
+            if (!err.empty()) fail(err);
+        } else if (cmd == "source"){
+            string name;
+            long long count = -1;
+            if (!(in >> name >> count) || count < 0){ fail("source needs <name> <count>"); continue; }
+            // Read the block even without an open job so the stream stays in sync.
+            bool ok = true;
+            vector<uint32_t> list;
+            if (open_job && !spare.empty()) { list.swap(spare.back()); spare.pop_back(); }
+            bool full = false;
+            for (long long k = 0; k < count; ++k){
+                if (!next_line()) { ok = false; break; }
+                if (open_job && !full && !line.empty()){
+                    if (items.full() && items.find(line) == ItemInterner::EMPTY) full = true;
+                    else list.push_back(items.intern(line));
+                }
+            }
+            if (!ok){ fail("source " + name + " ended early"); break; }
+            if (full){ fail("job has more than " + to_string(ItemInterner::MAX_ITEMS) + " distinct items"); continue; }
+            if (!open_job){ fail("source outside a job"); continue; }
+            src_items.push_back(std::move(list));
+            src_names.push_back(name);
+        } else if (cmd == "run"){
+            if (!open_job){ fail("run outside a job"); continue; }
+            if (src_items.empty()){ fail("job has no sources"); continue; }
+            long long big = first_overlong_source(src_items);
+            if (big >= 0){ fail("source " + src_names[big] + " has more than " + to_string(RANK_MAX_SOURCE_LEN) + " lines"); continue; }
+            auto t0 = std::chrono::steady_clock::now();
+            string notes;
+            vector<SourceReliability> rows = engine.run(items, src_items, src_names, opt, &notes);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            cerr << notes;
+
+            bool interval = opt.approx_eps > 0 || opt.bootstrap;
+            cout << "result " << ++jobs << " sources=" << rows.size() << " items=" << engine.universe()
+                 << " ms=" << std::fixed << setprecision(3) << ms << "\n";
+            cout << "source,n,inv_merge,inv_bit,inv_quick,max_inv,reliability";
+            if (interval) cout << ",reliability_lo,reliability_hi," << (opt.bootstrap ? "replicates" : "samples");
+            cout << "\n" << setprecision(6);
+            auto opt_col = [](long long v){ return v < 0 ? string() : to_string(v); };
+            for (auto& r : rows){
+                cout << r.src << "," << r.n << "," << opt_col(r.inv_merge) << "," << opt_col(r.inv_bit) << ","
+                     << opt_col(r.inv_quick) << "," << r.max_inv << "," << r.reliability;
+                if (interval) cout << "," << r.rel_lo << "," << r.rel_hi << "," << r.samples;
+                cout << "\n";
+            }
+            if (top > 0){
+                const vector<ConsensusEntry>& agg = engine.consensus();
+                cout << "position,item,sum_rank,avg_rank\n" << setprecision(4);
+                for (size_t i = 0; i < agg.size() && i < top; ++i)
+                    cout << (i + 1) << "," << items.view(agg[i].item) << "," << agg[i].sum << "," << agg[i].avg << "\n";
+            }
+            cout << "end\n";
+            cout.flush();
+            open_job = false;
+        } else {
+            fail("unknown command " + cmd);
+        }
+    }
+    return 0;
 }
 
 /**
  * @brief CLI entry: build consensus ranking, count inversions per source, write reports.
  *
  * Usage:
- *   rank_reliability [--quiet] --out OUT_DIR source1.txt [source2.txt ...]
+ *   rank_reliability [--quiet] [--threads N] [--pairwise] [--cache DIR] [--counter MODE] [--positions csv|bin] [--mem-limit SIZE] [--approx EPS] [--bootstrap B] [--consensus borda|kemeny-local] [--profile FILE] --out OUT_DIR source1.txt [source2.txt ...]
+ *   rank_reliability --incremental source1.txt [source2.txt ...]   (deltas on stdin)
+ *   rank_reliability --serve [--threads N]                         (jobs on stdin, see run_serve)
+ *
+ *   --cache DIR keeps a binary copy of every source (ranking_cache.hpp); unchanged
+ *   sources are reloaded from it instead of being parsed again.
+ *   --counter all|auto|verify|merge|bit picks the inversion counters (counter_engine.hpp);
+ *   all (default) runs merge + BIT + quick, verify three-way checks --verify-rate R of the sources.
+ *   --positions bin writes <source_name>_positions.bin (varint deltas) instead of the CSV.
+ *   --mem-limit SIZE (e.g. 512M, 4G) streams every position array into an out-of-core
+ *   counter (external_inversions.hpp) that spills sorted runs to --spill-dir DIR.
+ *   --approx EPS estimates each reliability within +-EPS (95%) from random pairs
+ *   (approx_inversions.hpp) and adds a confidence interval.
+ *   --bootstrap B resamples the items B times, rebuilds the Borda consensus each time and
+ *   adds a 95% percentile interval for every exact reliability (bootstrap.hpp).
+ *   --consensus kemeny-local refines the Borda order with local Kemeny moves (kemeny.hpp);
+ *   --kemeny-window W bounds how far one insertion may move an item (default 8).
+ *   --profile FILE writes per-phase and per-source timings, I/O, allocations and peak RSS
+ *   as JSON (profiler.hpp), including each counter inside three_way_inv.
  *
  * Inputs:
  *   - 1+ source files; each is a newline-separated list of item IDs (strings/ints),
@@ -197,8 +320,13 @@ static InvTriple three_way_inv(vector<long long> arr){
  * Outputs (written to OUT_DIR):
  *   - combined_order.csv          : (position, item, sum_rank, avg_rank)
  *   - inversions_summary.csv      : (source, n, inv_merge, inv_bit, inv_quick, max_inv, reliability)
+ *                                   counters that did not run leave their column empty;
+ *                                   --approx adds reliability_lo, reliability_hi, samples;
+ *                                   --bootstrap adds reliability_lo, reliability_hi, replicates
  *   - <source_name>_positions.csv : (index_in_source, combined_position)
+ *     or _positions.bin           : "RKPOS001", varint n, then n zigzag-varint deltas of combined_position
  *   - report.md                   : methodology + results table (merge-based)
+ *   - pairwise_distances.csv      : (--pairwise) S x S source-to-source inversion counts
  */
 int main(int argc, char** argv){
     ios::sync_with_stdio(false);
@@ -206,20 +334,165 @@ int main(int argc, char** argv){
 
     // ---- Args (single pass) -------------------------------------------------
     bool quiet = false;
+    bool incremental = false;
+    bool serve = false;
+    bool pairwise = false;
+    int threads = 1;
+    string counter = "all";
+    double verify_rate = 0.1;
+    bool positions_bin = false;
+    size_t mem_limit = 0;  // 0 = in-memory counters
+    double approx_eps = 0; // 0 = exact counts
+    int bootstrap = 0;     // replicates; 0 = no interval
+    bool kemeny = false;
+    int kemeny_window = 8;
+    string spill_dir;
     string out_dir;
+    string cache_dir;
+    string profile_path;
     vector<string> files;
 
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
         if (arg == "--help") {
             cout << "Usage: " << argv[0]
-                 << " [--quiet] --out OUT_DIR source1.txt [source2.txt ...]\n";
+                 << " [--quiet] [--threads N] [--incremental] [--serve] [--pairwise] [--cache DIR] [--counter MODE] [--positions csv|bin] [--mem-limit SIZE] [--approx EPS] [--bootstrap B] [--consensus borda|kemeny-local] [--profile FILE] --out OUT_DIR source1.txt [source2.txt ...]\n";
             return 0;
         }
         if (arg == "--quiet") {
             quiet = true;
             continue;
         }
+        if (arg == "--incremental") {
+            incremental = true;
+            continue;
+        }
+        if (arg == "--serve") {
+            serve = true;
+            continue;
+        }
+        if (arg == "--pairwise") {
+            pairwise = true;
+            continue;
+        }
+        if (arg == "--threads") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --threads requires a count\n";
+                return 1;
+            }
+            threads = atoi(argv[++i]);
+            if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+            continue;
+        }
+        if (arg == "--counter") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --counter requires a mode\n";
+                return 1;
+            }
+            counter = argv[++i];
+            const CounterEngine* e = find_counter(counter);
+            if (e && !e->exact) {
+                cerr << "Error: --counter " << counter << " is diagnostic only (use --counter all)\n";
+                return 1;
+            }
+            if (!e && counter != "all" && counter != "auto" && counter != "verify") {
+                cerr << "Error: --counter must be all, auto, verify, merge or bit\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--verify-rate") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --verify-rate requires a fraction\n";
+                return 1;
+            }
+            verify_rate = atof(argv[++i]);
+            continue;
+        }
+        if (arg == "--positions") {
+            string fmt = i + 1 < argc ? argv[++i] : "";
+            if (fmt != "csv" && fmt != "bin") {
+                cerr << "Error: --positions must be csv or bin\n";
+                return 1;
+            }
+            positions_bin = fmt == "bin";
+            continue;
+        }
+        if (arg == "--mem-limit") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --mem-limit requires a size\n";
+                return 1;
+            }
+            char* end = nullptr;
+            double v = strtod(argv[++i], &end);
+            int shift = 0;
+            if (*end == 'K' || *end == 'k') shift = 10;
+            else if (*end == 'M' || *end == 'm') shift = 20;
+            else if (*end == 'G' || *end == 'g') shift = 30;
+            if (v <= 0 || (*end && (!shift || end[1]))) {
+                cerr << "Error: --mem-limit must look like 65536, 512M or 4G\n";
+                return 1;
+            }
+            mem_limit = (size_t)(v * (double)(1ull << shift));
+            continue;
+        }
+        if (arg == "--consensus") {
+            string engine = i + 1 < argc ? argv[++i] : "";
+            if (engine != "borda" && engine != "kemeny-local") {
+                cerr << "Error: --consensus must be borda or kemeny-local\n";
+                return 1;
+            }
+            kemeny = engine == "kemeny-local";
+            continue;
+        }
+        if (arg == "--kemeny-window") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --kemeny-window requires a count\n";
+                return 1;
+            }
+            kemeny_window = max(1, atoi(argv[++i]));
+            continue;
+        }
+        if (arg == "--approx") {
+            approx_eps = i + 1 < argc ? atof(argv[++i]) : 0.0;
+            if (!(approx_eps > 0 && approx_eps < 1)) {
+                cerr << "Error: --approx requires an error bound in (0, 1)\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--bootstrap") {
+            bootstrap = i + 1 < argc ? atoi(argv[++i]) : 0;
+            if (bootstrap < 2) {
+                cerr << "Error: --bootstrap requires at least 2 replicates\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--spill-dir") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --spill-dir requires a directory\n";
+                return 1;
+            }
+            spill_dir = argv[++i];
+            continue;
+        }
+        if (arg == "--profile") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --profile requires a file\n";
+                return 1;
+            }
+            profile_path = argv[++i];
+            continue;
+        }
+        if (arg == "--cache") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --cache requires a directory\n";
+                return 1;
+            }
+            cache_dir = argv[++i];
+            continue;
+        }
         if (arg == "--out") {
             if (i + 1 >= argc) {
                 cerr << "Error: --out requires a directory\n";
@@ -231,157 +504,256 @@ int main(int argc, char** argv){
         if (!arg.empty() && arg[0] == '-') {
             cerr << "Unknown flag: " << arg << "\n";
             cerr << "Usage: " << argv[0]
-                 << " [--quiet] --out OUT_DIR source1.txt [source2.txt ...]\n";
+                 << " [--quiet] [--threads N] [--incremental] [--serve] [--pairwise] [--cache DIR] [--counter MODE] [--positions csv|bin] [--mem-limit SIZE] [--approx EPS] [--bootstrap B] [--consensus borda|kemeny-local] [--profile FILE] --out OUT_DIR source1.txt [source2.txt ...]\n";
             return 1;
         }
         files.push_back(arg);
     }
 
-    if (out_dir.empty() || files.empty()){
+    if (approx_eps > 0 && mem_limit){
+        cerr << "Error: --approx samples the in-memory position arrays; drop --mem-limit\n";
+        return 1;
+    }
+    if (mem_limit && mem_limit / (size_t)max(1, threads) < EXT_MIN_MEM){
+        cerr << "Error: --mem-limit is shared by the threads and needs at least "
+             << (EXT_MIN_MEM >> 10) << "K per thread\n";
+        return 1;
+    }
+    if (approx_eps > 0 && bootstrap){
+        cerr << "Error: --approx already reports an interval; drop --bootstrap\n";
+        return 1;
+    }
+
+    if (serve) return run_serve(threads, quiet);
+
+    if ((out_dir.empty() && !incremental) || files.empty()){
         cerr << "Usage: " << argv[0]
-             << " [--quiet] --out OUT_DIR source1.txt [source2.txt ...]\n";
+             << " [--quiet] [--threads N] [--incremental] [--serve] [--pairwise] [--cache DIR] [--counter MODE] [--positions csv|bin] [--mem-limit SIZE] [--approx EPS] [--bootstrap B] [--consensus borda|kemeny-local] [--profile FILE] --out OUT_DIR source1.txt [source2.txt ...]\n";
         return 1;
     }
 
-    // ---- Read sources; build universe ---------------------------------------
-    vector<vector<string>> src_items;
+    // --profile: the writer does not exist yet, so its byte count is read through a pointer.
+    Profiler prof;
+    AsyncWriter* writer_ptr = nullptr;
+    if (!profile_path.empty() && !incremental)
+        prof.enable([&]{ return writer_ptr ? writer_ptr->bytes_queued() : 0ull; });
+
+    // ---- Read sources; intern items into dense IDs -------------------------
+    prof.phase("parse");
+    ItemInterner items;                // item string <-> id (one arena)
+    vector<vector<uint32_t>> src_items; // per source: item IDs in source order
     vector<string> src_names;
-    unordered_set<string> universe;
+
+    RankingCache cache;
+    if (!cache_dir.empty() && !cache.open(cache_dir, items)){
+        cerr << "Failed to open cache " << cache_dir << "\n";
+        return 3;
+    }
 
     for (auto& f : files){
-        ifstream in(f);
-        if (!in){
-            cerr << "Failed to open " << f << "\n";
+        ProfSpan span;
+        if (prof.on()) span.start();
+        vector<uint32_t> list;
+        bool cached = !cache_dir.empty() && cache.load(src_items.size(), f, list);
+        try {
+            uint64_t hash = 0;
+            if (!cached && !load_source(f, items, list, cache_dir.empty() ? nullptr : &hash)){
+                cerr << "Failed to open " << f << "\n";
+                return 3;
+            }
+            if (!cached && !cache_dir.empty()) cache.parsed(src_items.size(), hash);
+        } catch (const std::length_error& e) {
+            cerr << "Error: " << f << ": " << e.what() << "\n";
             return 3;
         }
-        vector<string> list;
-        string line;
-        while (std::getline(in, line)){
-            if (!line.empty() && line.back()=='\r') line.pop_back(); // CRLF guard
-            if (line.empty()) continue;
-            list.push_back(line);
-            universe.insert(line);
-        }
-        src_items.push_back(std::move(list));
 
         size_t pos = f.find_last_of("/\\");
         src_names.push_back(pos==string::npos ? f : f.substr(pos+1));
+        if (prof.on()){
+            // Cached sources read their uint32 IDs; parsed ones the whole text file.
+            std::error_code fec;
+            uintmax_t size = cached ? 0 : std::filesystem::file_size(f, fec);
+            long long bytes = cached ? (long long)(list.size() * sizeof(uint32_t)) : fec ? 0 : (long long)size;
+            prof.add_read(bytes);
+            Profiler::Source ps;
+            ps.name = src_names.back();
+            ps.load = span.stop(bytes, 0);
+            prof.sources.push_back(std::move(ps));
+        }
+        src_items.push_back(std::move(list));
     }
-
-    // ---- Rank maps; missing rank = max_len + 1 ------------------------------
-    int S = (int)src_items.size();
-    unordered_map<string, vector<int>> ranks; // item -> per-source ranks
-    int max_len = 0;
-    for (int s=0; s<S; ++s) max_len = max<int>(max_len, (int)src_items[s].size());
-    int missing_rank = max_len + 1;
-
-    for (auto& item : universe) ranks[item] = vector<int>(S, missing_rank);
-    for (int s=0; s<S; ++s){
-        for (int i=0; i<(int)src_items[s].size(); ++i){
-            ranks[src_items[s][i]][s] = i+1;
+    prof.phase("universe");
+    if (!cache_dir.empty()){
+        // Also drops dictionary items no source uses; IDs then match an uncached run.
+        if (!cache.commit(items, src_items))
+            cerr << "[WARN] could not update cache " << cache_dir << "\n";
+        if (!quiet)
+            cerr << "[INFO] cache: " << cache.hits() << " reused, " << cache.misses() << " parsed\n";
+    }
+    if (incremental) return run_incremental(items, src_items, src_names);
+
+    // Universe = every interned ID (0..U-1); no string hashing past this point.
+    const uint32_t U = items.size();
+    long long big = first_overlong_source(src_items);
+    if (big >= 0){
+        cerr << "Error: " << src_names[big] << " has " << src_items[big].size()
+             << " lines; ranks are 32-bit, so a source may hold at most " << RANK_MAX_SOURCE_LEN << "\n";
+        return 3;
+    }
+    // --mem-limit bounds the counting only: the rank matrix and consensus stay in memory.
+    if (mem_limit){
+        const unsigned long long resident = ReliabilityEngine::resident_bytes(src_items, U, threads);
+        const unsigned long long ram = (unsigned long long)sysconf(_SC_PHYS_PAGES) * (unsigned long long)sysconf(_SC_PAGE_SIZE);
+        if (ram && resident > ram){
+            cerr << "Error: the rank matrix and consensus need " << (resident >> 20) << " MiB in memory, more than the "
+                 << (ram >> 20) << " MiB of RAM here; --mem-limit only moves the inversion counting out of core\n";
+            return 3;
         }
+        if (resident > mem_limit)
+            cerr << "[WARN] --mem-limit bounds the inversion counting only; the rank matrix and consensus keep "
+                 << ((resident + (1 << 20) - 1) >> 20) << " MiB in memory on top of it\n";
     }
 
-    // ---- Combined order by sum of ranks (avg tiebreak) ----------------------
-    struct Agg { string item; long long sum; double avg; };
-    vector<Agg> agg; agg.reserve(universe.size());
-    for (auto& kv : ranks){
-        long long sum = 0;
-        for (int s=0; s<S; ++s) sum += kv.second[s];
-        double avg = double(sum)/double(S);
-        agg.push_back({kv.first, sum, avg});
-    }
-    sort(agg.begin(), agg.end(), [&](const Agg& a, const Agg& b){
-        if (a.sum != b.sum) return a.sum < b.sum;
-        if (a.avg != b.avg) return a.avg < b.avg;
-        return a.item < b.item;
-    });
+    // ---- Rank matrix (S x U, source-major); missing rank = max_len + 1 -----
+    prof.phase("rank_matrix");
+    int S = (int)src_items.size();
+    ReliabilityEngine engine(threads);
+    WorkStealingPool& pool = engine.pool();
+    engine.build_ranks(src_items, U);
 
-    // Map item -> combined position
-    unordered_map<string,int> pos_combined;
-    pos_combined.reserve(agg.size()*2);
-    for (int i=0; i<(int)agg.size(); ++i) pos_combined[agg[i].item] = i+1;
+    // ---- Combined order by sum of ranks (avg tiebreak) ----------------------
+    prof.phase("consensus");
+    ReliabilityOptions opt;
+    opt.counter = counter;
+    opt.verify_rate = verify_rate;
+    opt.quiet = quiet;
+    opt.kemeny = kemeny;
+    opt.kemeny_window = kemeny_window;
+    opt.approx_eps = approx_eps;
+    opt.mem_limit = mem_limit;
+    opt.spill_dir = spill_dir;
+    opt.bootstrap = bootstrap;
+    engine.build_consensus(items, opt);
+    const vector<ConsensusEntry>& agg = engine.consensus();
+    const KemenyStats& kst = engine.kemeny_stats();
+    if (kemeny && !quiet)
+        cerr << "[INFO] kemeny-local: " << kst.rounds << " round(s), " << kst.swaps << " swaps, "
+             << kst.insertions << " insertions, " << kst.gain << " pairwise disagreements removed\n";
 
     // ---- Prepare output dir --------------------------------------------------
     std::error_code ec;
     std::filesystem::create_directories(out_dir, ec);
 
+    // Every file below is formatted into chunks and written by this one background thread.
+    AsyncWriter writer;
+    writer_ptr = &writer;
+
+    prof.phase("write_combined");
+
     // combined_order.csv
     {
-        ofstream out(out_dir + "/combined_order.csv");
+        OutBuffer out(writer, out_dir + "/combined_order.csv");
         out << "position,item,sum_rank,avg_rank\n";
-        out << std::fixed << setprecision(4);
         for (int i=0; i<(int)agg.size(); ++i){
-            out << (i+1) << "," << agg[i].item << "," << agg[i].sum << "," << agg[i].avg << "\n";
+            out << (i+1) << "," << items.view(agg[i].item) << "," << agg[i].sum << "," << fixed_point(agg[i].avg, 4) << "\n";
         }
     }
 
-    // ---- Per-source inversions & reliability --------------------------------
-    struct Row {
-        string src; long long n;
-        long long inv_merge, inv_bit, inv_quick, max_inv;
-        double reliability;
-    };
-    vector<Row> summary;
+    // ---- Per-source inversions & reliability (reliability.hpp) --------------
+    prof.phase("count");
+    vector<SourceReliability> summary(S);
+    vector<string> notes(S); // per-source stderr lines, printed in source order
 
-    long long N = (long long)agg.size();
-    long long max_inv = N*(N-1)/2;
+    vector<char> three_way(S, counter == "all");
+    if (counter == "verify") three_way = verify_sample((size_t)S, verify_rate);
 
-    for (int s=0; s<S; ++s){
-        // Build combined-position array in the order of source s
-        vector<long long> a; a.reserve(N);
-        for (auto& it : src_items[s]){
-            auto itp = pos_combined.find(it);
-            if (itp != pos_combined.end()) a.push_back(itp->second);
-        }
-        // Append items missing from this source at the end in combined order
-        if ((long long)a.size() < N){
-            unordered_set<string> present(src_items[s].begin(), src_items[s].end());
-            for (auto& ag : agg) if (!present.count(ag.item)) a.push_back(pos_combined[ag.item]);
-        }
+    long long N = engine.universe();
+    long long max_inv = engine.max_inversions();
 
-        // Run counters
-        InvTriple tr = three_way_inv(a);
+    // --mem-limit: the budget is shared by the workers; only the exact external count runs.
+    if (mem_limit){
+        if (spill_dir.empty()) opt.spill_dir = std::filesystem::temp_directory_path(ec).string();
+        if (counter != "all" && counter != "merge")
+            cerr << "[WARN] --mem-limit counts out of core; --counter " << counter << " is ignored\n";
+        counter = opt.counter = "merge"; // the external counter is a merge sort (report + summary columns)
+    }
 
-        // Ground truth: merge vs BIT must match
-        if (tr.merge_inv != tr.bit_inv){
-            cerr << "[ERROR] merge vs BIT disagree for " << src_names[s]
-                 << " | merge=" << tr.merge_inv
-                 << " bit=" << tr.bit_inv << "\n";
+    pool.run((size_t)S, [&](int w, size_t task){
+        int s = (int)task;
+        Profiler::Source* ps = prof.on() ? &prof.sources[s] : nullptr;
+        ProfSpan span;
+        if (ps) span.start();
+        summary[s] = engine.count_source(w, s, src_names[s], opt, three_way[s], notes[s], ps);
+        const SourceReliability& row = summary[s];
+
+        // Per-source mapping (regenerated, so --mem-limit never holds the array)
+        long long written = 0;
+        if (positions_bin){
+            OutBuffer out(writer, out_dir + "/" + src_names[s] + "_positions.bin");
+            out << "RKPOS001";
+            put_varint(out, (uint64_t)row.n);
+            long long prev = 0;
+            engine.for_each_position(w, s, [&](long long x){ put_zigzag(out, x - prev); prev = x; });
+            written = (long long)out.bytes();
+        } else {
+            OutBuffer out(writer, out_dir + "/" + src_names[s] + "_positions.csv");
+            out << "index_in_source,combined_position\n";
+            long long i = 0;
+            engine.for_each_position(w, s, [&](long long x){ out << ++i << "," << x << "\n"; });
+            written = (long long)out.bytes();
         }
-
-        // Quick is diagnostic only
-        if (!quiet && tr.quick_inv != tr.merge_inv) {
-            cerr << "[INFO] quick differs by "
-                 << (tr.merge_inv - tr.quick_inv)
-                 << " for " << src_names[s] << "\n";
+        if (ps){
+            ps->n = row.n;
+            ps->count = span.stop(0, written);
         }
+    });
+    for (auto& m : notes) cerr << m;
+
+    // ---- Bootstrap intervals (--bootstrap) ----------------------------------
+    if (bootstrap){
+        prof.phase("bootstrap");
+        if (kemeny && !quiet)
+            cerr << "[INFO] bootstrap replicates rebuild the Borda consensus (no Kemeny refinement)\n";
+        engine.bootstrap(summary, bootstrap);
+    }
 
-        double rel = 1.0 - (double)tr.merge_inv / (double)max_inv;
-        summary.push_back({src_names[s], (long long)a.size(),
-                           tr.merge_inv, tr.bit_inv, tr.quick_inv, max_inv, rel});
-
-        // Per-source mapping
-        ofstream out(out_dir + "/" + src_names[s] + "_positions.csv");
-        out << "index_in_source,combined_position\n";
-        for (size_t i=0; i<a.size(); ++i) out << (i+1) << "," << a[i] << "\n";
+    // ---- Source-to-source distances (--pairwise) ----------------------------
+    if (pairwise){
+        prof.phase("pairwise");
+        vector<long long> d = pairwise_kendall(src_items, engine.combined_positions(), pool);
+        OutBuffer out(writer, out_dir + "/pairwise_distances.csv");
+        out << "source";
+        for (auto& nm : src_names) out << "," << nm;
+        out << "\n";
+        for (int s = 0; s < S; ++s){
+            out << src_names[s];
+            for (int t = 0; t < S; ++t) out << "," << d[(size_t)s * S + t];
+            out << "\n";
+        }
     }
 
     // ---- Summary CSV ---------------------------------------------------------
+    prof.phase("write_reports");
     {
-        ofstream out(out_dir + "/inversions_summary.csv");
-        out << "source,n,inv_merge,inv_bit,inv_quick,max_inv,reliability\n";
-        out << std::fixed << setprecision(6);
+        OutBuffer out(writer, out_dir + "/inversions_summary.csv");
+        out << "source,n,inv_merge,inv_bit,inv_quick,max_inv,reliability";
+        if (approx_eps > 0) out << ",reliability_lo,reliability_hi,samples";
+        if (bootstrap) out << ",reliability_lo,reliability_hi,replicates";
+        out << "\n";
+        auto opt_col = [](long long v){ return v < 0 ? string() : to_string(v); };
         for (auto& r : summary){
-            out << r.src << "," << r.n << "," << r.inv_merge << ","
-                << r.inv_bit << "," << r.inv_quick << ","
-                << r.max_inv << "," << r.reliability << "\n";
+            out << r.src << "," << r.n << "," << opt_col(r.inv_merge) << ","
+                << opt_col(r.inv_bit) << "," << opt_col(r.inv_quick) << ","
+                << r.max_inv << "," << fixed_point(r.reliability, 6);
+            if (approx_eps > 0 || bootstrap)
+                out << "," << fixed_point(r.rel_lo, 6) << "," << fixed_point(r.rel_hi, 6) << "," << r.samples;
+            out << "\n";
         }
     }
 
     // ---- Markdown report (merge-based table; quick diagnostic only) ---------
     {
-        ofstream out(out_dir + "/report.md");
+        OutBuffer out(writer, out_dir + "/report.md");
         out << "# Ranking Reliability Report\n\n";
         out << "- Sources: " << S << "\n";
         out << "- Total unique items: " << N << "\n";
@@ -391,17 +763,58 @@ int main(int argc, char** argv){
                "For each source, we mapped its order to the combined order and counted inversions using "
                "two authoritative methods (Merge sort and Fenwick/BIT). A quicksort-style method is included "
                "for **diagnostic** insight only.\n\n";
+        if (kemeny)
+            out << "The Borda order was then refined by **local Kemeny search** (adjacent swaps and insertions "
+                   "of up to " << kemeny_window << " places), removing " << kst.gain
+                << " pairwise source disagreements; `sum_rank` in `combined_order.csv` is no longer monotonic.\n\n";
         out << "A **reliability score** is defined as `1 - (inversions / max_inversions)` ∈ [0,1]. Higher means closer to the consensus.\n\n";
-        out << "## Results (Merge-based)\n";
-        out << "| Source | n | Inversions (merge) | Reliability |\n";
-        out << "|---|---:|---:|---:|\n";
-        out << std::fixed << setprecision(6);
-        for (auto& r : summary){
-            out << "| " << r.src << " | " << r.n << " | " << r.inv_merge << " | " << r.reliability << " |\n";
+        bool merge_based = counter == "all" || counter == "merge";
+        if (approx_eps > 0){
+            out << "## Results (sampled, ±" << fixed_point(approx_eps, 6) << " at 95%)\n";
+            out << "| Source | n | Inversions (est.) | Reliability | 95% CI |\n";
+            out << "|---|---:|---:|---:|---|\n";
+            for (auto& r : summary){
+                out << "| " << r.src << " | " << r.n << " | " << r.inv << " | " << fixed_point(r.reliability, 6)
+                    << " | [" << fixed_point(r.rel_lo, 6) << ", " << fixed_point(r.rel_hi, 6) << "] |\n";
+            }
+            out << "\n_Estimated from random pairs (Hoeffding sample size, Wilson interval); no exact counter ran._\n";
+        } else {
+            if (merge_based) out << "## Results (Merge-based)\n";
+            else out << "## Results (" << counter << " counter)\n";
+            out << "| Source | n | Inversions" << (merge_based ? " (merge)" : "") << " | Reliability |"
+                << (bootstrap ? " 95% CI (bootstrap) |" : "") << "\n";
+            out << "|---|---:|---:|---:|" << (bootstrap ? "---|" : "") << "\n";
+            for (auto& r : summary){
+                out << "| " << r.src << " | " << r.n << " | " << r.inv << " | " << fixed_point(r.reliability, 6) << " |";
+                if (bootstrap) out << " [" << fixed_point(r.rel_lo, 6) << ", " << fixed_point(r.rel_hi, 6) << "] |";
+                out << "\n";
+            }
+            if (bootstrap)
+                out << "\n_Intervals: 2.5th and 97.5th percentiles over " << bootstrap
+                    << " bootstrap resamples of the items (consensus rebuilt each time)._\n";
+            if (counter == "all")
+                out << "\n_The quick partition counter is diagnostic and may differ; see `inversions_summary.csv` for all counters._\n";
+            else
+                out << "\n_Counted with `--counter " << counter << "`; counters that did not run are left empty in `inversions_summary.csv`._\n";
         }
-        out << "\n_The quick partition counter is diagnostic and may differ; see `inversions_summary.csv` for all counters._\n";
     }
 
+    prof.phase("flush");
+    if (!writer.finish()){
+        cerr << "Failed to write " << writer.failed_path() << "\n";
+        return 4;
+    }
+    if (prof.on()){
+        AsyncWriter pw;
+        {
+            OutBuffer out(pw, profile_path);
+            prof.write(out, pool.size());
+        }
+        if (!pw.finish()){
+            cerr << "Failed to write " << pw.failed_path() << "\n";
+            return 4;
+        }
+    }
     cerr << "[INFO] Done. Wrote outputs under: " << out_dir << "\n";
     return 0;
 }
@@ -0,0 +1,285 @@
+/**
+ * @file ranking_cache.hpp
+ * @brief --cache DIR: binary pre-indexed sources + one shared item dictionary.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * Why this exists:
+ * - Most runs re-read the same big .txt sources. Parsing and interning them is the
+ *   whole startup cost, even when only one file changed since the last run.
+ * - With a cache, a source is parsed once. Later runs copy its uint32 ID array straight
+ *   out of a mapped file and only re-parse the sources that changed.
+ *
+ * Files under DIR (native endianness, same machine only):
+ * - items.dict : header, off[count+1], hash[count], slots[cap], item bytes.
+ *                slots is the interner's probe table, so open() is four copies out of
+ *                the mapping (O(file size)): no hashing, no probing.
+ *                IDs are append-only within an epoch: new items go at the end.
+ * - <name>.<pathhash>.rkb : header (file size, mtime, content hash), then uint32 IDs.
+ *
+ * Staleness:
+ * - Same size and mtime -> trusted as is.
+ * - Same size, new mtime -> the text is hashed; same hash -> reused (and re-stamped).
+ * - Anything else, or a dictionary epoch / count mismatch -> parse the text again. The
+ *   parse hashes the same mapping (load_source's content_hash) and hands it to parsed(),
+ *   so a cold source is read once.
+ *
+ * The dictionary may hold items no current source uses. commit() compacts it when more
+ * than half of it (and at least DICT_COMPACT_MIN_DEAD items) is dead: only the items of
+ * this run's sources are kept, a new epoch starts, and every source of the run is
+ * rewritten; cached sources that were not part of the run are parsed again next time.
+ * Either way commit() leaves IDs renumbered by first use (ItemInterner::compact), so
+ * IDs (and every output) match a run without --cache.
+ *
+ * SSR: load dict -> per source: stamp check -> mmap IDs or parse text -> compact if mostly dead
+ *      -> save dict -> save stale sources.
+ */
+#ifndef RANKING_CACHE_HPP
+#define RANKING_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "source_loader.hpp"
+
+class RankingCache {
+public:
+    /**
+     * @brief Use @p dir as the cache and load its dictionary into @p items.
+     *
+     * @p items must be empty. A missing or unreadable dictionary starts a new epoch,
+     * which invalidates every source file left from the old one.
+     * @return false if the directory cannot be created
+     */
+    bool open(const std::string& dir, ItemInterner& items) {
+        dir_ = dir;
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        if (!std::filesystem::is_directory(dir_, ec)) return false;
+
+        MappedFile mf;
+        DictHeader h;
+        if (mf.open(dict_path()) && mf.size() >= sizeof h) {
+            std::memcpy(&h, mf.data(), sizeof h);
+            bool sane = std::memcmp(h.magic, DICT_MAGIC, 8) == 0 && h.count < 0xFFFFFFFFull
+                     && h.slots <= ((uint64_t)1 << 34);
+            size_t need = sizeof h + (size_t)(2 * h.count + 1) * sizeof(uint64_t)
+                        + (size_t)h.slots * sizeof(uint32_t) + (size_t)h.bytes;
+            if (sane && mf.size() == need) {
+                // off/hash are 8-byte aligned: the header is 40 bytes and the map is page aligned.
+                const uint64_t* off = reinterpret_cast<const uint64_t*>(mf.data() + sizeof h);
+                const uint64_t* hash = off + h.count + 1;
+                const uint32_t* slots = reinterpret_cast<const uint32_t*>(hash + h.count);
+                const char* bytes = reinterpret_cast<const char*>(slots + h.slots);
+                if (off[h.count] == h.bytes
+                    && items.adopt(bytes, off, hash, (uint32_t)h.count, slots, (size_t)h.slots)) {
+                    epoch_ = h.epoch;
+                    saved_count_ = (uint32_t)h.count;
+                    return true;
+                }
+            }
+        }
+        epoch_ = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count() | 1;
+        saved_count_ = 0;
+        dict_dirty_ = true;
+        return true;
+    }
+
+    /**
+     * @brief Try to fill @p out for source @p s from the cache.
+     *
+     * On a miss the source is remembered: the caller parses it, reports its content hash
+     * with parsed(), and commit() writes its IDs. IDs in @p out index the dictionary
+     * loaded by open().
+     */
+    bool load(size_t s, const std::string& path, std::vector<uint32_t>& out) {
+        Stamp st;
+        if (!stamp(path, st)) return false;
+        std::string cpath = source_path(path);
+
+        MappedFile mf;
+        SourceHeader h;
+        bool usable = mf.open(cpath) && mf.size() >= sizeof h;
+        if (usable) {
+            std::memcpy(&h, mf.data(), sizeof h);
+            usable = std::memcmp(h.magic, SRC_MAGIC, 8) == 0 && h.epoch == epoch_
+                  && h.dict_count <= saved_count_ && h.size == st.size
+                  && mf.size() == sizeof h + (size_t)h.n * sizeof(uint32_t);
+        }
+        bool hashed = false;
+        if (usable && h.mtime != st.mtime) {
+            st.content_hash = content_hash(path);
+            hashed = true;
+            usable = h.content_hash == st.content_hash;
+            if (usable) pending_.push_back({s, path, st, true}); // touched but unchanged: re-stamp
+        }
+        if (!usable) {
+            pending_.push_back({s, path, st, true}); // content hash comes from parsed()
+            ++misses_;
+            return false;
+        }
+        if (!hashed) {
+            st.content_hash = h.content_hash;
+            pending_.push_back({s, path, st, false}); // rewritten only if the dictionary is compacted
+        }
+        out.resize((size_t)h.n);
+        if (h.n) std::memcpy(out.data(), mf.data() + sizeof h, (size_t)h.n * sizeof(uint32_t));
+        ++hits_;
+        return true;
+    }
+
+    /**
+     * @brief Write the grown (or compacted) dictionary, then the sources that need it.
+     *
+     * Call once, after every source is loaded. Afterwards @p items holds only the items
+     * of @p src_items, renumbered by first use (ItemInterner::compact), and the lists
+     * use the new IDs. The dictionary goes first so a source file never points past the
+     * dictionary on disk.
+     */
+    bool commit(ItemInterner& items, std::vector<std::vector<uint32_t>>& src_items) {
+        std::vector<char> live(items.size(), 0);
+        size_t n_live = 0;
+        for (const auto& l : src_items)
+            for (uint32_t id : l) if (!live[id]) { live[id] = 1; ++n_live; }
+        const size_t dead = items.size() - n_live;
+        const bool shrink = dead > n_live && dead >= DICT_COMPACT_MIN_DEAD;
+        if (shrink) {
+            items.compact(src_items);
+            epoch_ = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count() | 1;
+            dict_dirty_ = true;
+        }
+
+        bool ok = true;
+        if (dict_dirty_ || items.size() != saved_count_) {
+            ok = write_dict(items);
+            if (ok) saved_count_ = items.size();
+        }
+        for (const Pending& p : pending_) {
+            if (!ok) break;
+            if (p.dirty || shrink) ok = write_source(p, src_items[p.s]);
+        }
+        pending_.clear();
+        if (!shrink) items.compact(src_items);
+        return ok;
+    }
+
+    // Content hash of missed source @p s, computed while parsing it (see load_source).
+    void parsed(size_t s, uint64_t content_hash) {
+        for (Pending& p : pending_) if (p.s == s) p.st.content_hash = content_hash;
+    }
+
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    static constexpr char DICT_MAGIC[9] = "RKDICT02";
+    static constexpr size_t DICT_COMPACT_MIN_DEAD = 4096; // small dictionaries are cheap to keep
+    static constexpr char SRC_MAGIC[9] = "RKSRC001";
+
+    struct DictHeader { char magic[8]; uint64_t epoch, count, bytes, slots; };
+    struct SourceHeader {
+        char magic[8];
+        uint64_t epoch, size;
+        int64_t mtime;
+        uint64_t content_hash, dict_count, n;
+    };
+    struct Stamp { uint64_t size = 0; int64_t mtime = 0; uint64_t content_hash = 0; };
+    struct Pending { size_t s; std::string path; Stamp st; bool dirty; }; // dirty: stale on disk
+
+    std::string dir_;
+    uint64_t epoch_ = 0;
+    uint32_t saved_count_ = 0;
+    bool dict_dirty_ = false;
+    std::vector<Pending> pending_;
+    size_t hits_ = 0, misses_ = 0;
+
+    std::string dict_path() const { return dir_ + "/items.dict"; }
+
+    // <basename>.<hash of absolute path>.rkb, so same-named files in different folders differ.
+    std::string source_path(const std::string& path) const {
+        std::error_code ec;
+        std::string abs = std::filesystem::absolute(path, ec).string();
+        if (ec) abs = path;
+        size_t cut = path.find_last_of("/\\");
+        char hex[17];
+        std::snprintf(hex, sizeof hex, "%016llx",
+                      (unsigned long long)ItemInterner::hash_bytes(abs.data(), abs.size()));
+        return dir_ + "/" + (cut == std::string::npos ? path : path.substr(cut + 1)) + "." + hex + ".rkb";
+    }
+
+    static bool stamp(const std::string& path, Stamp& st) {
+        std::error_code ec;
+        st.size = (uint64_t)std::filesystem::file_size(path, ec);
+        if (ec) return false;
+        auto t = std::filesystem::last_write_time(path, ec);
+        if (ec) return false;
+        st.mtime = (int64_t)t.time_since_epoch().count();
+        return true;
+    }
+
+    static uint64_t content_hash(const std::string& path) {
+        MappedFile mf;
+        if (!mf.open(path)) return 0;
+        return ItemInterner::hash_bytes(mf.data(), mf.size());
+    }
+
+    // Write to a temp name, then rename, so a crash never leaves a torn file behind.
+    template <class Fn>
+    static bool write_atomic(const std::string& path, Fn&& body) {
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            body(out);
+            if (!out) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+
+    bool write_dict(const ItemInterner& items) {
+        DictHeader h;
+        std::memcpy(h.magic, DICT_MAGIC, 8);
+        h.epoch = epoch_;
+        h.count = items.size();
+        h.bytes = items.arena_bytes();
+        h.slots = items.slots().size();
+        return write_atomic(dict_path(), [&](std::ofstream& out){
+            out.write(reinterpret_cast<const char*>(&h), sizeof h);
+            out.write(reinterpret_cast<const char*>(items.offsets().data()),
+                      (std::streamsize)(items.offsets().size() * sizeof(uint64_t)));
+            out.write(reinterpret_cast<const char*>(items.hashes().data()),
+                      (std::streamsize)(items.hashes().size() * sizeof(uint64_t)));
+            out.write(reinterpret_cast<const char*>(items.slots().data()),
+                      (std::streamsize)(items.slots().size() * sizeof(uint32_t)));
+            out.write(items.arena_data(), (std::streamsize)items.arena_bytes());
+        });
+    }
+
+    bool write_source(const Pending& p, const std::vector<uint32_t>& ids) {
+        SourceHeader h;
+        std::memcpy(h.magic, SRC_MAGIC, 8);
+        h.epoch = epoch_;
+        h.size = p.st.size;
+        h.mtime = p.st.mtime;
+        h.content_hash = p.st.content_hash;
+        h.dict_count = saved_count_;
+        h.n = ids.size();
+        return write_atomic(source_path(p.path), [&](std::ofstream& out){
+            out.write(reinterpret_cast<const char*>(&h), sizeof h);
+            out.write(reinterpret_cast<const char*>(ids.data()),
+                      (std::streamsize)(ids.size() * sizeof(uint32_t)));
+        });
+    }
+};
+
+#endif
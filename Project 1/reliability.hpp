@@ -0,0 +1,323 @@
+/**
+ * @file reliability.hpp
+ * @brief Embeddable core of rank_reliability: consensus, per-source inversions, reliability.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * Everything here works on in-memory inputs (an ItemInterner + per-source ID lists) and
+ * returns in-memory results. No files, no stdout. rank_reliability's batch mode and
+ * --serve mode are both thin drivers around it.
+ *
+ * A ReliabilityEngine owns the thread pool and every per-worker buffer, so keeping one
+ * engine alive across many jobs means no thread start-up and warm scratch after the first job.
+ *
+ * API:
+ *   ReliabilityEngine eng(threads);
+ *   eng.build_ranks(src_items, items.size());
+ *   eng.build_consensus(items, opt);                          // order + combined positions
+ *   for s: rows[s] = eng.count_source(w, s, name, opt, three_way, notes);   // thread-safe per s
+ *   eng.bootstrap(rows, opt.bootstrap);                         // optional intervals
+ * or, for one call that does all of it:
+ *   std::vector<SourceReliability> rows = eng.run(items, src_items, names, opt);
+ *
+ * SSR: rank matrix -> Borda (+ Kemeny) order -> positions per source -> counters -> 1 - inv/max_inv.
+ */
+#ifndef RELIABILITY_HPP
+#define RELIABILITY_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "approx_inversions.hpp"
+#include "bootstrap.hpp"
+#include "consensus.hpp"
+#include "counter_engine.hpp"
+#include "external_inversions.hpp"
+#include "inversions.hpp"
+#include "kemeny.hpp"
+#include "profiler.hpp"
+#include "source_loader.hpp"
+#include "work_pool.hpp"
+
+struct ReliabilityOptions {
+    std::string counter = "all"; // all | auto | verify | merge | bit
+    double verify_rate = 0.1;    // share of sources "verify" cross-checks
+    bool quiet = false;          // drop the "[INFO] quick differs" notes
+    bool kemeny = false;         // refine the Borda order (kemeny.hpp)
+    int kemeny_window = 8;
+    double approx_eps = 0;       // > 0: sampled reliability (approx_inversions.hpp)
+    size_t mem_limit = 0;        // > 0: out-of-core counting, shared by the workers
+    std::string spill_dir;       // for mem_limit; empty = system temp directory
+    int bootstrap = 0;           // replicates for run(); 0 = no interval
+};
+
+// inv is the count used for reliability (estimated under approx_eps); per-counter
+// columns are -1 if not run. rel_lo/rel_hi/samples are only set by approx_eps
+// (Wilson interval, pairs drawn) or bootstrap() (percentile interval, replicates).
+struct SourceReliability {
+    std::string src; long long n;
+    long long inv, inv_merge, inv_bit, inv_quick, max_inv;
+    double reliability;
+    double rel_lo = 0, rel_hi = 0;
+    long long samples = 0;
+};
+
+struct ConsensusEntry { uint32_t item; long long sum; double avg; };
+
+class ReliabilityEngine {
+public:
+    // @p threads as for WorkStealingPool (values < 1 mean 1).
+    explicit ReliabilityEngine(int threads) : pool_(threads), scratch_(pool_.size()) {}
+
+    ReliabilityEngine(const ReliabilityEngine&) = delete;
+    ReliabilityEngine& operator=(const ReliabilityEngine&) = delete;
+
+    WorkStealingPool& pool() { return pool_; }
+
+    /**
+     * @brief Bytes the in-memory part of a run keeps resident, whatever --mem-limit says.
+     *
+     * The S x U int32 rank matrix, the ID lists, about 64 bytes per item for the consensus
+     * (sums, entries, positions, radix keys) and every worker's U-entry stamp array.
+     * --mem-limit only bounds the position arrays and the counting on top of this.
+     */
+    static unsigned long long resident_bytes(const std::vector<std::vector<uint32_t>>& src_items,
+                                             uint32_t U, int threads) {
+        unsigned long long lines = 0;
+        for (const auto& l : src_items) lines += l.size();
+        return (unsigned long long)src_items.size() * U * sizeof(int32_t) + lines * sizeof(uint32_t)
+             + (unsigned long long)U * (64 + (unsigned long long)std::max(1, threads) * sizeof(uint32_t));
+    }
+
+    // ---- Rank matrix (S x U, source-major); missing rank = max_len + 1 -----
+    void build_ranks(const std::vector<std::vector<uint32_t>>& src_items, uint32_t U) {
+        src_ = &src_items;
+        ranks_ = build_rank_matrix(src_items, U);
+    }
+
+    /**
+     * @brief Combined order by sum of ranks (avg tiebreak), optionally Kemeny-refined.
+     *
+     * avg = sum/S never breaks a tie that sum did not, so the order is (sum, item):
+     * radix sort on sums, strings compared only inside ties. Needs build_ranks() first.
+     */
+    void build_consensus(const ItemInterner& items, const ReliabilityOptions& opt) {
+        const uint32_t U = ranks_.U;
+        const int S = ranks_.S;
+        sums_ = borda_sums(ranks_);
+        items_ = &items;
+        lex_.clear(); // the bootstrap builds it on demand
+        std::vector<uint32_t> order = consensus_order(sums_, [&](uint32_t id){ return items.view(id); }, &pool_);
+        kemeny_ = KemenyStats();
+        if (opt.kemeny) kemeny_ = kemeny_local(order, ranks_, pool_, opt.kemeny_window);
+        agg_.clear();
+        agg_.reserve(U);
+        for (uint32_t id : order) agg_.push_back({id, sums_[id], double(sums_[id]) / double(S)});
+
+        // Map item id -> combined position
+        pos_combined_.resize(U);
+        uint32_t pos = 0; // positions 1..U, and U < 2^32 since IDs are uint32
+        for (const ConsensusEntry& ag : agg_) pos_combined_[ag.item] = ++pos;
+
+        // Stamps are source indices, so they must not survive into the next job.
+        for (auto& sc : scratch_) sc.seen.assign(U, 0);
+    }
+
+    const std::vector<ConsensusEntry>& consensus() const { return agg_; }
+    const RankMatrix& ranks() const { return ranks_; }
+    // Item ID -> 1-based position in the combined order (what for_each_position emits).
+    const std::vector<uint32_t>& combined_positions() const { return pos_combined_; }
+    const KemenyStats& kemeny_stats() const { return kemeny_; }
+    long long universe() const { return (long long)agg_.size(); }
+    long long max_inversions() const { long long N = universe(); return N * (N - 1) / 2; }
+
+    /**
+     * @brief Combined positions in the order of source s, then the items it misses
+     *        (appended at the end in combined order). Uses worker @p w's scratch.
+     */
+    template <class Emit>
+    void for_each_position(int w, int s, Emit&& emit) {
+        const std::vector<uint32_t>& l = (*src_)[s];
+        for (uint32_t id : l) emit((long long)pos_combined_[id]);
+        if (l.size() < agg_.size()) {
+            std::vector<uint32_t>& seen = scratch_[w].seen;
+            const uint32_t stamp = (uint32_t)s + 1;
+            for (uint32_t id : l) seen[id] = stamp;
+            for (auto& ag : agg_) if (seen[ag.item] != stamp) emit((long long)pos_combined_[ag.item]);
+        }
+    }
+
+    /**
+     * @brief Count inversions of source s and grade it; call from pool worker @p w.
+     *
+     * @param three_way run merge + BIT + quick and cross-check (ignored under mem_limit/approx)
+     * @param notes     receives this source's "[ERROR]"/"[INFO]" lines
+     * @param ps        optional --profile record for this source
+     */
+    SourceReliability count_source(int w, int s, const std::string& name, const ReliabilityOptions& opt,
+                                   bool three_way, std::string& notes, Profiler::Source* ps = nullptr) {
+        Scratch& sc = scratch_[w];
+        const long long N = universe(), max_inv = max_inversions();
+        // Wall time of the engine that produced row.inv (when three_way_inv did not).
+        long long engine_t0 = 0;
+        auto engine_start = [&]{ if (ps) engine_t0 = prof_wall_ns(); };
+        auto engine_stop = [&](const char* used){
+            if (ps) { ps->engine = used; ps->engine_ns = prof_wall_ns() - engine_t0; }
+        };
+        if (opt.mem_limit || opt.approx_eps > 0) three_way = false;
+
+        std::vector<long long>& a = sc.a;
+        a.clear();
+        SourceReliability row{name, 0, 0, -1, -1, -1, max_inv, 0.0};
+        std::ostringstream msg;
+        if (opt.mem_limit) {
+            // Positions are <= N < 2^32 (IDs are uint32), so spill runs use 32-bit values.
+            std::string dir = opt.spill_dir;
+            std::error_code ec;
+            if (dir.empty()) dir = std::filesystem::temp_directory_path(ec).string();
+            engine_start();
+            ExternalInversionCounter<uint32_t> ext(opt.mem_limit / (size_t)pool_.size(), dir);
+            for_each_position(w, s, [&](long long p){ ext.push((uint32_t)p); ++row.n; });
+            if (!ext.finish(row.inv))
+                msg << "[ERROR] external count failed for " << name << " (spill dir " << dir << ")\n";
+            engine_stop("external");
+            row.inv_merge = row.inv;
+        } else {
+            a.reserve(N);
+            for_each_position(w, s, [&](long long p){ a.push_back(p); });
+            row.n = (long long)a.size();
+        }
+
+        // Run counters
+        if (three_way) {
+            InvTriple tr = three_way_inv(a, sc.cnt, ps ? &ps->times : nullptr);
+            if (ps) ps->three_way = true;
+            row.inv = tr.merge_inv;
+            row.inv_merge = tr.merge_inv; row.inv_bit = tr.bit_inv; row.inv_quick = tr.quick_inv;
+
+            // Ground truth: merge vs BIT must match
+            if (tr.merge_inv != tr.bit_inv) {
+                msg << "[ERROR] merge vs BIT disagree for " << name
+                    << " | merge=" << tr.merge_inv
+                    << " bit=" << tr.bit_inv << "\n";
+            }
+
+            // Quick is diagnostic only
+            if (!opt.quiet && tr.quick_inv != tr.merge_inv) {
+                msg << "[INFO] quick differs by "
+                    << (tr.merge_inv - tr.quick_inv)
+                    << " for " << name << "\n";
+            }
+        }
+        const CounterEngine* single = find_counter(opt.counter);
+        if (opt.mem_limit) {
+            // already counted out of core
+        } else if (opt.approx_eps > 0) {
+            // Sample the discordant fraction; scale so the bound holds for reliability
+            // (pairs of this array vs max_inv differ when a source repeats items).
+            double pairs = (double)row.n * (double)(row.n - 1) / 2.0;
+            double scale = max_inv > 0 ? pairs / (double)max_inv : 0.0;
+            long long m = scale > 0 ? hoeffding_samples(opt.approx_eps / scale, APPROX_DELTA) : 0;
+            engine_start();
+            ApproxInv est = sample_discordance(a, m, 0x9E3779B97F4A7C15ull ^ (uint64_t)s);
+            engine_stop("approx");
+            row.inv = std::llround(est.p * pairs);
+            row.reliability = 1.0 - est.p * scale;
+            row.rel_lo = 1.0 - est.hi * scale;
+            row.rel_hi = 1.0 - est.lo * scale;
+            row.samples = est.samples;
+        } else if (single) {
+            engine_start();
+            row.inv = single->count(a, sc.cnt);
+            engine_stop(single->name);
+            (single == find_counter("bit") ? row.inv_bit : row.inv_merge) = row.inv;
+        } else if (opt.counter != "all") {
+            // auto / verify: one tuned exact engine; sampled sources also ran the three-way check.
+            const char* used = nullptr;
+            engine_start();
+            long long inv = auto_count(a, sc.cnt, used);
+            engine_stop(used);
+            if (three_way && inv != row.inv_merge) {
+                msg << "[ERROR] auto (" << used << ") vs merge disagree for " << name
+                    << " | auto=" << inv << " merge=" << row.inv_merge << "\n";
+            }
+            row.inv = inv;
+            if (!three_way) (std::string(used) == "bit" ? row.inv_bit : row.inv_merge) = inv;
+        }
+        notes = msg.str();
+
+        if (opt.approx_eps <= 0) row.reliability = max_inv > 0 ? 1.0 - (double)row.inv / (double)max_inv : 1.0;
+        return row;
+    }
+
+    /**
+     * @brief 95% percentile intervals from @p B bootstrap replicates (bootstrap.hpp).
+     *
+     * Replicates rebuild the Borda consensus (no Kemeny refinement).
+     */
+    void bootstrap(std::vector<SourceReliability>& rows, int B, uint64_t seed = 0x5EED5EEDull) {
+        const int S = ranks_.S;
+        if (lex_.empty() && ranks_.U > 0)
+            lex_ = lexicographic_ranks(ranks_.U, [&](uint32_t id){ return items_->view(id); }, by_lex_);
+        std::vector<double> rel = bootstrap_reliability(*src_, ranks_, lex_, B, seed, pool_);
+        std::vector<double> col(B);
+        for (int s = 0; s < S; ++s) {
+            for (int b = 0; b < B; ++b) col[b] = rel[(size_t)b * S + s];
+            percentile_interval(col, 0.95, rows[s].rel_lo, rows[s].rel_hi);
+            rows[s].samples = B;
+        }
+    }
+
+    /**
+     * @brief Whole pipeline in memory: consensus, every source, optional bootstrap.
+     *
+     * three_way follows opt.counter ("all" = every source, "verify" = a fixed sample).
+     * Per-source notes are appended to @p notes in source order when given.
+     */
+    std::vector<SourceReliability> run(const ItemInterner& items,
+                                       const std::vector<std::vector<uint32_t>>& src_items,
+                                       const std::vector<std::string>& names,
+                                       const ReliabilityOptions& opt, std::string* notes = nullptr) {
+        const int S = (int)src_items.size();
+        build_ranks(src_items, items.size());
+        build_consensus(items, opt);
+        std::vector<char> three_way(S, opt.counter == "all");
+        if (opt.counter == "verify") three_way = verify_sample((size_t)S, opt.verify_rate);
+        std::vector<SourceReliability> rows(S);
+        notes_.resize(S);
+        pool_.run((size_t)S, [&](int w, size_t s){
+            rows[s] = count_source(w, (int)s, names[s], opt, three_way[s], notes_[s]);
+        });
+        if (notes) for (int s = 0; s < S; ++s) *notes += notes_[s];
+        if (opt.bootstrap > 0) bootstrap(rows, opt.bootstrap);
+        return rows;
+    }
+
+private:
+    // Per-worker scratch, reused across the sources (and jobs) a worker picks up.
+    struct Scratch {
+        std::vector<long long> a;   // combined positions in source order
+        std::vector<uint32_t> seen; // seen[id] == s+1 -> id present in source s
+        CounterScratch cnt;         // counter buffers (merge, quick)
+    };
+
+    WorkStealingPool pool_;
+    std::vector<Scratch> scratch_;
+    const std::vector<std::vector<uint32_t>>* src_ = nullptr;
+    RankMatrix ranks_;
+    std::vector<long long> sums_;
+    const ItemInterner* items_ = nullptr; // from build_consensus, for the bootstrap's lex order
+    std::vector<uint32_t> lex_, by_lex_;  // bootstrap only
+    std::vector<ConsensusEntry> agg_;
+    std::vector<uint32_t> pos_combined_;
+    KemenyStats kemeny_;
+    std::vector<std::string> notes_;
+};
+
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file report_writer.hpp
+ * @brief Output stage: to_chars formatting into big buffers + one background writer thread.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * Why this exists:
+ * - Writing the CSVs with ofstream << one field at a time, inside the per-source loop,
+ *   made the output slower than the inversion counting at large N.
+ * - Here each worker formats into its own 1 MiB chunks with std::to_chars (no locale,
+ *   no stream state) and queues the full chunks. One writer thread does all the file
+ *   I/O, so formatting and counting keep going while the disk catches up.
+ *
+ * Pieces:
+ * - AsyncWriter : FIFO of open/write/close operations, drained by one thread. Bytes in
+ *                 flight are capped, so a fast producer blocks instead of using up RAM.
+ * - OutBuffer   : one output file. operator<< for text and integers, fixed_point(v, p) for doubles
+ *                 (same digits as std::fixed << setprecision(p)). Closes on destruction.
+ * - put_varint / put_zigzag : helpers for the compact binary positions format.
+ *
+ * SSR: format into chunk -> queue chunk -> writer thread fwrite()s in order -> finish() reports errors.
+ */
+#ifndef REPORT_WRITER_HPP
+#define REPORT_WRITER_HPP
+
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <system_error>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class AsyncWriter {
+public:
+    // @p max_inflight caps queued-but-unwritten bytes (producers wait above it).
+    explicit AsyncWriter(size_t max_inflight = (size_t)64 << 20)
+        : max_inflight_(max_inflight), thread_([this]{ loop(); }) {}
+
+    ~AsyncWriter() { finish(); }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    // Returns a handle for write/close; the file is created by the writer thread.
+    int open(const std::string& path) {
+        std::lock_guard<std::mutex> lk(m_);
+        int fh = next_fh_++;
+        ops_.push_back({Op::Open, fh, path});
+        cv_work_.notify_one();
+        return fh;
+    }
+
+    void write(int fh, std::string&& data) {
+        if (data.empty()) return;
+        std::unique_lock<std::mutex> lk(m_);
+        // Always accept into an empty queue so one oversized chunk cannot deadlock.
+        cv_space_.wait(lk, [&]{ return inflight_ == 0 || inflight_ + data.size() <= max_inflight_; });
+        inflight_ += data.size();
+        queued_ += data.size();
+        ops_.push_back({Op::Write, fh, std::move(data)});
+        cv_work_.notify_one();
+    }
+
+    void close(int fh) {
+        std::lock_guard<std::mutex> lk(m_);
+        ops_.push_back({Op::Close, fh, std::string()});
+        cv_work_.notify_one();
+    }
+
+    /**
+     * @brief Drain the queue and stop the thread (idempotent).
+     * @return false if any file could not be opened or fully written
+     */
+    bool finish() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_work_.notify_one();
+        if (thread_.joinable()) thread_.join();
+        return !failed_;
+    }
+
+    // First path that failed (empty if none); valid after finish().
+    const std::string& failed_path() const { return failed_path_; }
+
+    // Bytes handed to write() so far (queued or already on disk).
+    unsigned long long bytes_queued() {
+        std::lock_guard<std::mutex> lk(m_);
+        return queued_;
+    }
+
+private:
+    struct Op {
+        enum Kind { Open, Write, Close } kind;
+        int fh;
+        std::string data; // path for Open, bytes for Write
+    };
+
+    size_t max_inflight_;
+    size_t inflight_ = 0;
+    unsigned long long queued_ = 0;
+    std::deque<Op> ops_;
+    int next_fh_ = 0;
+    bool stop_ = false;
+    bool failed_ = false;      // written by the writer thread, read after join
+    std::string failed_path_;
+    std::mutex m_;
+    std::condition_variable cv_work_, cv_space_;
+    std::thread thread_; // last: starts after everything above exists
+
+    void loop() {
+        // Handles are dense and ops are FIFO, so an Open always precedes its writes.
+        std::vector<std::FILE*> files;
+        std::vector<std::string> paths;
+        auto fail = [&](int fh){
+            if (!failed_) failed_path_ = paths[fh];
+            failed_ = true;
+        };
+        for (;;) {
+            Op op;
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_work_.wait(lk, [&]{ return stop_ || !ops_.empty(); });
+                if (ops_.empty()) return; // stop_ and drained
+                op = std::move(ops_.front());
+                ops_.pop_front();
+            }
+            if (op.kind == Op::Open && files.size() <= (size_t)op.fh) {
+                files.resize(op.fh + 1, nullptr);
+                paths.resize(op.fh + 1);
+            }
+            std::FILE*& f = files[op.fh];
+            if (op.kind == Op::Open) {
+                paths[op.fh] = op.data;
+                f = std::fopen(op.data.c_str(), "wb");
+                if (f) std::setvbuf(f, nullptr, _IONBF, 0); // chunks are already large
+                else fail(op.fh);
+            } else if (op.kind == Op::Write) {
+                if (f && std::fwrite(op.data.data(), 1, op.data.size(), f) != op.data.size()) fail(op.fh);
+                {
+                    std::lock_guard<std::mutex> lk(m_);
+                    inflight_ -= op.data.size();
+                }
+                cv_space_.notify_all();
+            } else {
+                if (f && std::fclose(f) != 0) fail(op.fh);
+                f = nullptr;
+            }
+        }
+    }
+};
+
+/**
+ * @brief One output file fed through an AsyncWriter.
+ *
+ * Usage:
+ *   OutBuffer out(writer, dir + "/x.csv");
+ *   out << "a,b\n" << 42 << "," << fixed_point(3.14159, 4) << "\n";
+ */
+class OutBuffer {
+public:
+    static constexpr size_t CHUNK = (size_t)1 << 20;
+
+    OutBuffer(AsyncWriter& w, const std::string& path) : w_(w), fh_(w.open(path)) { buf_.reserve(CHUNK); }
+    ~OutBuffer() { flush(); w_.close(fh_); }
+
+    OutBuffer(const OutBuffer&) = delete;
+    OutBuffer& operator=(const OutBuffer&) = delete;
+
+    OutBuffer& operator<<(std::string_view s) { buf_.append(s.data(), s.size()); spill(); return *this; }
+    OutBuffer& operator<<(const char* s) { return *this << std::string_view(s); }
+    OutBuffer& operator<<(const std::string& s) { return *this << std::string_view(s); }
+    OutBuffer& operator<<(char c) { buf_.push_back(c); spill(); return *this; }
+
+    template <class T, class = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char>>>
+    OutBuffer& operator<<(T v) {
+        char tmp[24];
+        auto r = std::to_chars(tmp, tmp + sizeof tmp, v);
+        buf_.append(tmp, (size_t)(r.ptr - tmp));
+        spill();
+        return *this;
+    }
+
+    // A double printed like std::fixed << setprecision(precision).
+    struct Fixed { double v; int precision; };
+    OutBuffer& operator<<(Fixed f) {
+        char tmp[400]; // enough for any finite double at the precisions we print
+        auto r = std::to_chars(tmp, tmp + sizeof tmp, f.v, std::chars_format::fixed, f.precision);
+        if (r.ec == std::errc()) buf_.append(tmp, (size_t)(r.ptr - tmp));
+        else *this << "nan";
+        spill();
+        return *this;
+    }
+
+    // Raw bytes for binary formats.
+    void put(uint8_t b) { buf_.push_back((char)b); spill(); }
+
+    // Bytes formatted into this file so far.
+    size_t bytes() const { return flushed_ + buf_.size(); }
+
+    void flush() {
+        if (buf_.empty()) return;
+        std::string full;
+        full.reserve(CHUNK);
+        full.swap(buf_);
+        flushed_ += full.size();
+        w_.write(fh_, std::move(full));
+    }
+
+private:
+    AsyncWriter& w_;
+    int fh_;
+    std::string buf_;
+    size_t flushed_ = 0;
+
+    void spill() { if (buf_.size() >= CHUNK) flush(); }
+};
+
+inline OutBuffer::Fixed fixed_point(double v, int precision) { return {v, precision}; }
+
+// LEB128: 7 bits per byte, high bit = more bytes follow.
+inline void put_varint(OutBuffer& out, uint64_t v) {
+    while (v >= 0x80) { out.put((uint8_t)(v | 0x80)); v >>= 7; }
+    out.put((uint8_t)v);
+}
+
+// Signed delta -> unsigned (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...), then varint.
+inline void put_zigzag(OutBuffer& out, int64_t v) {
+    put_varint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+#endif
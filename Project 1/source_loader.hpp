@@ -0,0 +1,321 @@
+/**
+ * @file source_loader.hpp
+ * @brief mmap-based source reader + string interner (one arena, dense uint32 item IDs).
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * Why this exists:
+ * - The first version read every source with ifstream/getline and kept each line as a
+ *   std::string in three different containers (source list, universe set, rank map).
+ *   With big sources that is most of the runtime and most of the memory.
+ * - Here every distinct line is stored exactly once (in one arena) and gets a dense
+ *   uint32_t ID. After loading, the rest of the program only moves integers around.
+ *
+ * Parsing rules (same as the old getline loop):
+ * - Lines are split on '\n'; a trailing '\r' is dropped (CRLF guard).
+ * - Empty lines are skipped; a last line without '\n' still counts.
+ *
+ * SSR: mmap file -> split lines in place -> intern each line once -> vector<uint32_t> per source.
+ */
+#ifndef SOURCE_LOADER_HPP
+#define SOURCE_LOADER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Read-only memory map of a whole file (RAII).
+ *
+ * Notes:
+ * - Empty files are valid: data() is nullptr and size() is 0.
+ * - The mapping is private and read-only; nothing we do can touch the file.
+ * - Pipes, FIFOs and <(...) have no size to map: they are read() to EOF into an
+ *   owned buffer instead, so they load the same as a regular file.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map @p path; returns false if it cannot be opened/mapped/read.
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        if (!S_ISREG(st.st_mode)) {
+            bool ok = read_all(fd);
+            ::close(fd);
+            return ok;
+        }
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); size_ = 0; return false; }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+        }
+        ::close(fd); // the mapping stays valid after close
+        return true;
+    }
+
+    void close() {
+        if (data_ && buf_.empty()) munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        buf_.clear();
+        buf_.shrink_to_fit();
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> buf_; // non-empty only for a non-regular file (read, not mapped)
+
+    // read() until EOF; the buffer doubles so a big pipe costs O(size) copies.
+    bool read_all(int fd) {
+        std::vector<char> buf(1 << 16);
+        size_t len = 0;
+        for (;;) {
+            if (len == buf.size()) buf.resize(buf.size() * 2);
+            ssize_t r = ::read(fd, buf.data() + len, buf.size() - len);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (r == 0) break;
+            len += (size_t)r;
+        }
+        if (len == 0) return true; // empty stream: same as an empty file
+        buf.resize(len);
+        buf_.swap(buf);
+        data_ = buf_.data();
+        size_ = len;
+        return true;
+    }
+};
+
+/**
+ * @brief Interns strings into dense IDs 0..size()-1, all bytes in one arena.
+ *
+ * Layout:
+ * - arena_ holds item bytes back to back; item i is [off_[i], off_[i+1]).
+ * - slots_ is an open-addressing table (linear probing) of IDs; hash_ caches the
+ *   hash of every ID so probing and rehashing never touch the arena.
+ *
+ * API:
+ *   ItemInterner in;
+ *   uint32_t id = in.intern("A");  // same string -> same id
+ *   in.find("B");                   // EMPTY: never interned
+ *   in.view(id);                    // "A" (valid until the next intern call)
+ *   in.compact(lists);              // drop IDs no list uses, renumber by first use
+ *   in.clear();                     // empty again, capacity kept
+ *
+ * At most MAX_ITEMS distinct items: one more would get the ID EMPTY, which marks free
+ * slots, so intern() throws std::length_error instead.
+ */
+class ItemInterner {
+public:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+    static constexpr uint32_t MAX_ITEMS = EMPTY - 1;
+
+    ItemInterner() : off_(1, 0) {}
+
+    uint32_t intern(std::string_view s) {
+        if ((size_t)(count() + 1) * 2 > slots_.size()) grow();
+        uint64_t h = hash_bytes(s.data(), s.size());
+        size_t mask = slots_.size() - 1;
+        for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+            uint32_t id = slots_[i];
+            if (id == EMPTY) {
+                if (full()) throw std::length_error("more than 2^32 - 2 distinct items");
+                id = count();
+                arena_.insert(arena_.end(), s.begin(), s.end());
+                off_.push_back(arena_.size());
+                hash_.push_back(h);
+                slots_[i] = id;
+                return id;
+            }
+            if (hash_[id] == h && view(id) == s) return id;
+        }
+    }
+
+    // Look up without inserting; EMPTY if @p s was never interned.
+    uint32_t find(std::string_view s) const {
+        if (slots_.empty()) return EMPTY;
+        uint64_t h = hash_bytes(s.data(), s.size());
+        size_t mask = slots_.size() - 1;
+        for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+            uint32_t id = slots_[i];
+            if (id == EMPTY) return EMPTY;
+            if (hash_[id] == h && view(id) == s) return id;
+        }
+    }
+
+    std::string_view view(uint32_t id) const {
+        return std::string_view(arena_.data() + off_[id], (size_t)(off_[id + 1] - off_[id]));
+    }
+
+    uint32_t size() const { return count(); }
+    bool full() const { return count() >= MAX_ITEMS; }
+    size_t arena_bytes() const { return arena_.size(); }
+
+    // Forget every item but keep the arena and table capacity (--serve reuses one interner).
+    void clear() {
+        arena_.clear();
+        off_.assign(1, 0);
+        hash_.clear();
+        std::fill(slots_.begin(), slots_.end(), EMPTY);
+    }
+
+    // Raw tables (for the on-disk dictionary in ranking_cache.hpp).
+    const char* arena_data() const { return arena_.data(); }
+    const std::vector<uint64_t>& offsets() const { return off_; }
+    const std::vector<uint64_t>& hashes() const { return hash_; }
+    const std::vector<uint32_t>& slots() const { return slots_; }
+
+    /**
+     * @brief Replace the contents with n entries whose hashes are already known.
+     *
+     * off has n+1 entries starting at 0 and indexes @p bytes. Nothing is re-hashed,
+     * so reloading a saved dictionary is a copy plus one probe per entry.
+     */
+    void adopt(const char* bytes, const uint64_t* off, const uint64_t* hash, uint32_t n) {
+        arena_.assign(bytes, bytes + off[n]);
+        off_.assign(off, off + n + 1);
+        hash_.assign(hash, hash + n);
+        slots_.clear();
+        size_t cap = 1024;
+        while ((size_t)(n + 1) * 2 > cap) cap *= 2;
+        rehash(cap);
+    }
+
+    /**
+     * @brief adopt() with a saved probe table too: plain copies, no probing at all.
+     *
+     * @p slots (@p cap entries) must come from slots() of an interner holding exactly
+     * these n entries; returns false (contents unchanged) if it cannot be such a table.
+     */
+    bool adopt(const char* bytes, const uint64_t* off, const uint64_t* hash, uint32_t n,
+               const uint32_t* slots, size_t cap) {
+        if ((cap & (cap - 1)) != 0 || (size_t)n * 2 > cap) return false;
+        for (size_t i = 0; i < cap; ++i) if (slots[i] != EMPTY && slots[i] >= n) return false;
+        arena_.assign(bytes, bytes + off[n]);
+        off_.assign(off, off + n + 1);
+        hash_.assign(hash, hash + n);
+        slots_.assign(slots, slots + cap);
+        return true;
+    }
+
+    /**
+     * @brief Keep only the IDs that appear in @p lists, renumbered by first occurrence.
+     *
+     * Lists are scanned in order and rewritten in place. The result is the same ID
+     * assignment that interning the lists from scratch would give, without hashing.
+     */
+    void compact(std::vector<std::vector<uint32_t>>& lists) {
+        std::vector<uint32_t> remap(count(), EMPTY);
+        std::vector<char> arena;
+        std::vector<uint64_t> off(1, 0), hash;
+        for (auto& l : lists) {
+            for (uint32_t& id : l) {
+                if (remap[id] == EMPTY) {
+                    remap[id] = (uint32_t)hash.size();
+                    std::string_view v = view(id);
+                    arena.insert(arena.end(), v.begin(), v.end());
+                    off.push_back(arena.size());
+                    hash.push_back(hash_[id]);
+                }
+                id = remap[id];
+            }
+        }
+        adopt(arena.data(), off.data(), hash.data(), (uint32_t)hash.size());
+    }
+
+    // 8 bytes per step multiply-xorshift mix; items are short so this is plenty.
+    static uint64_t hash_bytes(const char* p, size_t n) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ (uint64_t)n;
+        while (n >= 8) {
+            uint64_t w; std::memcpy(&w, p, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+            p += 8; n -= 8;
+        }
+        uint64_t w = 0; std::memcpy(&w, p, n);
+        h = (h ^ w) * 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 29;
+        return h;
+    }
+
+private:
+    std::vector<char> arena_;
+    std::vector<uint64_t> off_;
+    std::vector<uint64_t> hash_;
+    std::vector<uint32_t> slots_;
+
+    uint32_t count() const { return (uint32_t)(off_.size() - 1); }
+
+    void grow() { rehash(slots_.empty() ? 1024 : slots_.size() * 2); }
+
+    void rehash(size_t cap) {
+        slots_.assign(cap, EMPTY);
+        size_t mask = cap - 1;
+        for (uint32_t id = 0; id < count(); ++id) {
+            size_t i = (size_t)hash_[id] & mask;
+            while (slots_[i] != EMPTY) i = (i + 1) & mask;
+            slots_[i] = id;
+        }
+    }
+
+};
+
+/**
+ * @brief Load one source: mmap it, split into lines, intern each line.
+ *
+ * @param path  source file (newline-separated ranked list, best first)
+ * @param items interner shared by all sources (IDs are global)
+ * @param out   receives the item IDs in source order (duplicates kept, like before)
+ * @param content_hash if set, receives ItemInterner::hash_bytes of the whole file, taken
+ *        from the same mapping (the --cache stamp without reading the file twice)
+ * @return false if the file cannot be opened
+ * @throws std::length_error if @p items fills up (ItemInterner::MAX_ITEMS)
+ */
+inline bool load_source(const std::string& path, ItemInterner& items,
+                        std::vector<uint32_t>& out, uint64_t* content_hash = nullptr) {
+    MappedFile mf;
+    if (!mf.open(path)) return false;
+    if (content_hash) *content_hash = ItemInterner::hash_bytes(mf.data(), mf.size());
+    out.clear();
+    const char* p = mf.data();
+    const char* end = p + mf.size();
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        const char* eol = nl ? nl : end;
+        size_t len = (size_t)(eol - p);
+        if (len > 0 && p[len - 1] == '\r') --len; // CRLF guard
+        if (len > 0) out.push_back(items.intern(std::string_view(p, len)));
+        p = nl ? nl + 1 : end;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file test_inversions.cpp
+ * @brief Regression checks for the inversion counters (make test).
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * bit_count_inversions must agree with merge_count (the reference). quick_partition_count
+ * is a diagnostic that skips pivot pairs, so it is not checked here. The cases cover:
+ * - the sparse (radix) path, with value ranges just above a 16-bit digit boundary
+ *   ((2^16, 2^17], (2^32, 2^33] and (2^48, 2^49]), where a missing radix pass used to
+ *   leave the keys unsorted;
+ * - extreme values (LLONG_MIN / LLONG_MAX), where max - min overflows long long;
+ * - the dense and permutation paths;
+ * - ExternalInversionCounter at its 64 KiB floor (many runs, several merge passes).
+ *
+ * SSR: generate -> merge reference -> compare bit -> exit 1 if any case differs.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "external_inversions.hpp"
+#include "inversions.hpp"
+
+static int failures = 0;
+
+static void check(const char* name, const std::vector<long long>& a) {
+    std::vector<long long> m(a);
+    const long long want = merge_count(m);
+    const long long bit = bit_count_inversions(a);
+    if (bit != want) {
+        std::printf("FAIL %s (n=%zu): merge=%lld bit=%lld\n", name, a.size(), want, bit);
+        ++failures;
+    }
+}
+
+int main() {
+    check("gap 2^16", {0, 65536, 1});
+    check("extremes", {LLONG_MAX, LLONG_MIN, 0, LLONG_MIN + 1, LLONG_MAX - 1});
+    check("full range", {LLONG_MIN, LLONG_MAX, LLONG_MIN});
+
+    std::mt19937_64 rng(7);
+    // ranges whose top value sits right above a 16-bit digit boundary
+    for (int digit : {16, 32, 48}) {
+        for (int rep = 0; rep < 50; ++rep) {
+            const unsigned long long range = (1ULL << digit) + 1 + rng() % (1ULL << digit);
+            std::vector<long long> a(1000);
+            for (auto& x : a) x = (long long)(rng() % range) - (long long)(range / 2);
+            a[0] = -(long long)(range / 2);                    // pin min and max so the
+            a[1] = (long long)(range - 1) - (long long)(range / 2); // range is exact
+            char name[32];
+            std::snprintf(name, sizeof name, "range 2^%d+", digit);
+            check(name, a);
+        }
+    }
+    for (int rep = 0; rep < 50; ++rep) { // values < 1e5 (sparse, 17-bit keys)
+        std::vector<long long> a(1000);
+        for (auto& x : a) x = (long long)(rng() % 100000);
+        check("values < 1e5", a);
+    }
+    for (int rep = 0; rep < 20; ++rep) { // dense and permutation paths
+        std::vector<long long> a(5000);
+        for (size_t i = 0; i < a.size(); ++i) a[i] = (long long)i + 1;
+        std::shuffle(a.begin(), a.end(), rng);
+        check("permutation", a);
+        for (auto& x : a) x = (long long)(rng() % 3000);
+        check("dense with ties", a);
+    }
+
+    { // out of core at the smallest budget: 8192-value runs, fan-in 2 with 21 KiB buffers
+        std::vector<long long> a(300000);
+        for (auto& x : a) x = (long long)(rng() % 1000000);
+        ExternalInversionCounter<uint32_t> ext(EXT_MIN_MEM, "/tmp");
+        for (long long x : a) ext.push((uint32_t)x);
+        long long got = -1;
+        std::vector<long long> m(a);
+        const long long want = merge_count(m);
+        if (!ext.finish(got) || got != want) {
+            std::printf("FAIL external 64K (n=%zu): merge=%lld external=%lld\n", a.size(), want, got);
+            ++failures;
+        }
+    }
+
+    if (failures) { std::printf("%d failure(s)\n", failures); return 1; }
+    std::printf("all inversion checks passed\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file work_pool.hpp
+ * @brief Small work-stealing thread pool for "run task i for i in [0, n)" jobs.
+ * @author
+ *   Batuhan Sencer & Larry To
+ *
+ * How it works:
+ * - The calling thread is worker 0; the pool owns workers 1..size()-1.
+ * - run(n, fn) splits [0, n) into one contiguous range per worker.
+ *   A worker pops tasks from the front of its own range. When it runs dry it
+ *   steals the back half of another worker's range, so slow tasks (big sources)
+ *   never leave the other cores idle.
+ * - fn(worker, task) gets the worker index so callers can keep per-thread scratch
+ *   buffers in a vector indexed by worker.
+ *
+ * Determinism:
+ * - The pool only decides *who* runs a task. Callers write results into slot [task],
+ *   so the final output does not depend on scheduling.
+ *
+ * SSR: split range per worker -> pop own front -> steal half from a victim's back -> join.
+ */
+#ifndef WORK_POOL_HPP
+#define WORK_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    // @p threads total workers including the caller; values < 1 mean 1.
+    explicit WorkStealingPool(int threads) {
+        if (threads < 1) threads = 1;
+        ranges_.reset(new Range[threads]);
+        nworkers_ = threads;
+        for (int w = 1; w < threads; ++w) workers_.emplace_back([this, w]{ worker_loop(w); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_start_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return nworkers_; }
+
+    /**
+     * @brief Run fn(worker, task) for every task in [0, n); returns when all are done.
+     *
+     * The first exception thrown by a task is rethrown here (remaining tasks still run).
+     */
+    void run(size_t n, const std::function<void(int, size_t)>& fn) {
+        if (n == 0) return;
+        if (nworkers_ == 1) {
+            for (size_t t = 0; t < n; ++t) fn(0, t);
+            return;
+        }
+        for (int w = 0; w < nworkers_; ++w) {
+            std::lock_guard<std::mutex> lk(ranges_[w].m);
+            ranges_[w].lo = n * (size_t)w / (size_t)nworkers_;
+            ranges_[w].hi = n * (size_t)(w + 1) / (size_t)nworkers_;
+        }
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            fn_ = &fn;
+            error_ = nullptr;
+            busy_ = nworkers_ - 1;
+            ++generation_;
+        }
+        cv_start_.notify_all();
+
+        drain(0);
+
+        std::unique_lock<std::mutex> lk(m_);
+        cv_done_.wait(lk, [this]{ return busy_ == 0; });
+        fn_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    struct alignas(64) Range {
+        std::mutex m;
+        size_t lo = 0, hi = 0;
+    };
+
+    int nworkers_ = 1;
+    std::unique_ptr<Range[]> ranges_;
+    std::vector<std::thread> workers_;
+
+    std::mutex m_;
+    std::condition_variable cv_start_, cv_done_;
+    const std::function<void(int, size_t)>* fn_ = nullptr;
+    std::exception_ptr error_;
+    unsigned long long generation_ = 0;
+    int busy_ = 0;
+    bool stop_ = false;
+
+    bool pop_own(int w, size_t& task) {
+        Range& r = ranges_[w];
+        std::lock_guard<std::mutex> lk(r.m);
+        if (r.lo >= r.hi) return false;
+        task = r.lo++;
+        return true;
+    }
+
+    // Take the back half of some victim's range; run its first task now, keep the rest.
+    bool steal(int w, size_t& task) {
+        for (int k = 1; k < nworkers_; ++k) {
+            Range& v = ranges_[(w + k) % nworkers_];
+            size_t lo, hi;
+            {
+                std::lock_guard<std::mutex> lk(v.m);
+                if (v.lo >= v.hi) continue;
+                hi = v.hi;
+                lo = v.hi - (v.hi - v.lo + 1) / 2;
+                v.hi = lo;
+            }
+            task = lo;
+            std::lock_guard<std::mutex> lk(ranges_[w].m);
+            ranges_[w].lo = lo + 1;
+            ranges_[w].hi = hi;
+            return true;
+        }
+        return false;
+    }
+
+    void drain(int w) {
+        size_t task;
+        while (pop_own(w, task) || steal(w, task)) {
+            try {
+                (*fn_)(w, task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(m_);
+                if (!error_) error_ = std::current_exception();
+            }
+        }
+    }
+
+    void worker_loop(int w) {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_start_.wait(lk, [&]{ return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            drain(w);
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                if (--busy_ == 0) cv_done_.notify_all();
+            }
+        }
+    }
+};
+
+#endif
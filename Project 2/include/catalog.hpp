@@ -0,0 +1,442 @@
+/*
+Course catalog loader shared by topo_courses and plan_semesters.
+@Authors: Batuhan Sencer - Larry To
+
+Text format (CSV, one record per line, see data/courses.csv):
+    # comment
+    CS 1411 - Programming Principles I                                  <- course
+    CS 1411 - Programming Principles I,CS 1412 - Programming Principles II  <- edge PRE,POST
+- Fields are trimmed; a field may be "quoted" ("" inside quotes = one quote),
+  which allows commas in names. Blank lines and # lines are skipped.
+- IDs are given in order of first appearance, so declaring every course first
+  fixes the ID order. If the file declares any course, every edge endpoint must
+  be declared too: a typo is an error with its line number, not a new course.
+
+Loading:
+- The file is mmap'ed and scanned once by a hand-rolled tokenizer. Names are
+  interned (64 records at a time, with prefetching) in an open-addressing table
+  over one shared byte blob; each edge goes straight into flat from/to arrays,
+  then into the CSR Graph in one build.
+
+Binary snapshot (saveSnapshot, picked up by loadCatalog from its magic):
+    "TOPOCAT1" | u64 n | u64 m | u64 blobBytes
+    | u64 nameOffsets[n + 1] | blob | u64 csrOffsets[n + 1] | i32 targets[m]
+  Native byte order. Reloading is a few memcpy's: no parsing, no hashing
+  (the name index is only built if someone looks a name up).
+*/
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph.hpp"
+
+static_assert(sizeof(size_t) == 8, "catalog snapshots store 64-bit offsets");
+
+// Read-only mapping of a whole file (empty files map to an empty view).
+// Pipes, FIFOs and <(...) cannot be mapped (st_size is 0): they are read to
+// EOF into an owned buffer instead.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open catalog: " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat catalog: " + path);
+        }
+        if (!S_ISREG(st.st_mode)) {
+            readAll(path);
+            return;
+        }
+        len = (size_t)st.st_size;
+        if (len > 0) {
+            void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot mmap catalog: " + path);
+            }
+            ::madvise(p, len, MADV_SEQUENTIAL);
+            base = (const char*)p;
+        }
+    }
+    ~MappedFile() {
+        if (base && buf.empty()) ::munmap((void*)base, len);
+        if (fd >= 0) ::close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return base; }
+    size_t size() const { return len; }
+
+private:
+    int fd = -1;
+    const char* base = nullptr;
+    size_t len = 0;
+    std::vector<char> buf; // only used for non-regular files
+
+    void readAll(const std::string& path) {
+        buf.resize(1 << 16);
+        for (;;) {
+            if (len == buf.size()) buf.resize(buf.size() * 2);
+            ssize_t r = ::read(fd, buf.data() + len, buf.size() - len);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) {
+                ::close(fd);
+                fd = -1;
+                throw std::runtime_error("cannot read catalog: " + path);
+            }
+            if (r == 0) break;
+            len += (size_t)r;
+        }
+        buf.resize(len);
+        if (len > 0) base = buf.data();
+    }
+};
+
+// Interned names: id -> bytes in one blob, name -> id via linear probing.
+// A slot keeps the name's blob position and length, so a hit costs the slot
+// and the name bytes (callers can prefetch both), not a trip through offsets[].
+class NameTable {
+public:
+    int size() const { return (int)offsets.size() - 1; }
+
+    std::string_view name(int id) const {
+        return std::string_view(blob.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    // Returns the id of s (-1 if unknown).
+    int find(std::string_view s) const {
+        ensureIndex();
+        size_t i = hash(s) & mask;
+        for (; slots[i].id >= 0; i = (i + 1) & mask) {
+            if (matches(slots[i], s)) return slots[i].id;
+        }
+        return -1;
+    }
+
+    // Returns the id of s, adding it if new (added tells which). h = hash(s).
+    int intern(std::string_view s, size_t h, bool& added) {
+        ensureIndex();
+        if ((size_t)(size() + 1) * 2 > slots.size()) rehash(slots.size() * 2);
+        size_t i = h & mask;
+        for (; slots[i].id >= 0; i = (i + 1) & mask) {
+            if (matches(slots[i], s)) {
+                added = false;
+                return slots[i].id;
+            }
+        }
+        int id = size();
+        slots[i] = {blob.size(), (uint32_t)s.size(), id};
+        blob.append(s.data(), s.size());
+        offsets.push_back(blob.size());
+        added = true;
+        return id;
+    }
+    int intern(std::string_view s, bool& added) { return intern(s, hash(s), added); }
+
+    // Batch lookups: prefetch the home slot, then (once it has arrived) its name.
+    void prefetchSlot(size_t h) const {
+        ensureIndex();
+        __builtin_prefetch(&slots[h & mask]);
+    }
+    void prefetchName(size_t h) const {
+        const Slot& sl = slots[h & mask];
+        if (sl.id >= 0) __builtin_prefetch(blob.data() + sl.pos);
+    }
+
+    static size_t hash(std::string_view s) {
+        // 8 bytes at a time, multiply-xorshift mix
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+        size_t i = 0;
+        for (; i + 8 <= s.size(); i += 8) {
+            uint64_t w;
+            std::memcpy(&w, s.data() + i, 8);
+            h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 31;
+        }
+        uint64_t w = 0;
+        std::memcpy(&w, s.data() + i, s.size() - i);
+        // splitmix64 finish: low bits (the probe index) depend on every input bit
+        h ^= w;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return (size_t)(h ^ (h >> 31));
+    }
+
+    std::string blob;                   // all names back to back
+    std::vector<size_t> offsets{0};     // name id = blob[offsets[id] .. offsets[id+1])
+
+private:
+    struct Slot {
+        size_t pos;      // name bytes = blob[pos .. pos + len)
+        uint32_t len;
+        int id;          // -1 = empty
+    };
+    mutable std::vector<Slot> slots;    // built lazily (e.g. after a snapshot load)
+    mutable size_t mask = 0;
+
+    bool matches(const Slot& sl, std::string_view s) const {
+        return sl.len == s.size() && std::memcmp(blob.data() + sl.pos, s.data(), s.size()) == 0;
+    }
+
+    void ensureIndex() const {
+        if (slots.empty()) rehash(64);
+    }
+
+    void rehash(size_t want) const {
+        size_t cap = 64;
+        while (cap < want || cap < (size_t)size() * 2 + 2) cap *= 2;
+        slots.assign(cap, Slot{0, 0, -1});
+        mask = cap - 1;
+        for (int id = 0; id < size(); id++) {
+            std::string_view s = name(id);
+            size_t i = hash(s) & mask;
+            while (slots[i].id >= 0) i = (i + 1) & mask;
+            slots[i] = {offsets[id], (uint32_t)s.size(), id};
+        }
+    }
+};
+
+struct Catalog {
+    NameTable names;
+    Graph graph{0};
+
+    int size() const { return names.size(); }
+    std::string_view name(int id) const { return names.name(id); }
+};
+
+const char CATALOG_MAGIC[8] = {'T', 'O', 'P', 'O', 'C', 'A', 'T', '1'};
+
+namespace catalog_detail {
+
+inline std::runtime_error lineError(const std::string& path, size_t line, const std::string& msg) {
+    return std::runtime_error(path + ":" + std::to_string(line) + ": " + msg);
+}
+
+// A parsed field: bytes in the mapping, or (quoted) unescaped into the arena.
+struct Field {
+    size_t pos, len;
+    bool quoted;
+    size_t hash;
+};
+
+// One field starting at p (stops at ',' or end of line).
+inline Field readField(const char*& p, const char* base, const char* end, std::string& arena,
+                       const std::string& path, size_t line) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == '"') {
+        size_t pos = arena.size();
+        p++;
+        for (;;) {
+            if (p >= end || *p == '\n') throw lineError(path, line, "unterminated quote");
+            if (*p == '"') {
+                if (p + 1 < end && p[1] == '"') {
+                    arena.push_back('"');
+                    p += 2;
+                    continue;
+                }
+                p++;
+                break;
+            }
+            arena.push_back(*p++);
+        }
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p < end && *p != ',' && *p != '\n') throw lineError(path, line, "text after closing quote");
+        return {pos, arena.size() - pos, true, 0};
+    }
+    const char* b = p;
+    while (p < end && *p != ',' && *p != '\n') p++;
+    const char* e = p;
+    while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+    return {(size_t)(b - base), (size_t)(e - b), false, 0};
+}
+
+// Records are interned in batches: hash all fields and prefetch their slots,
+// then prefetch the names those slots point at, then intern in file order
+// (so IDs are still first-appearance order). This hides most of the cache
+// misses that dominate a one-at-a-time hash lookup on big catalogs.
+const size_t CATALOG_BATCH = 64;
+
+inline Catalog parseText(const char* p, const char* end, const std::string& path) {
+    const char* base = p;
+    Catalog cat;
+    std::vector<int> from, to;
+    std::vector<char> declared;      // per id
+    std::vector<size_t> firstLine;   // per id, for the "unknown course" error
+    bool anyDeclared = false;
+    size_t line = 0;
+
+    struct Record {
+        Field a, b;
+        bool edge;
+        size_t line;
+    };
+    std::vector<Record> batch;
+    batch.reserve(CATALOG_BATCH);
+    std::string arena;
+
+    auto view = [&](const Field& f) {
+        return f.quoted ? std::string_view(arena.data() + f.pos, f.len)
+                        : std::string_view(base + f.pos, f.len);
+    };
+    auto intern = [&](const Field& f, size_t at) {
+        bool added;
+        int id = cat.names.intern(view(f), f.hash, added);
+        if (added) {
+            declared.push_back(0);
+            firstLine.push_back(at);
+        }
+        return id;
+    };
+    auto flush = [&]() {
+        for (Record& r : batch) {
+            r.a.hash = NameTable::hash(view(r.a));
+            cat.names.prefetchSlot(r.a.hash);
+            if (r.edge) {
+                r.b.hash = NameTable::hash(view(r.b));
+                cat.names.prefetchSlot(r.b.hash);
+            }
+        }
+        for (const Record& r : batch) {
+            cat.names.prefetchName(r.a.hash);
+            if (r.edge) cat.names.prefetchName(r.b.hash);
+        }
+        for (const Record& r : batch) {
+            if (r.edge) {
+                int u = intern(r.a, r.line);
+                int v = intern(r.b, r.line);
+                from.push_back(u);
+                to.push_back(v);
+            } else {
+                int id = intern(r.a, r.line);
+                declared[id] = 1;
+                anyDeclared = true;
+            }
+        }
+        batch.clear();
+        arena.clear();
+    };
+
+    while (p < end) {
+        line++;
+        const char* q = p;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+        if (q >= end || *q == '\n' || *q == '#') {
+            while (p < end && *p != '\n') p++;
+            p++;
+            continue;
+        }
+        Record r;
+        r.line = line;
+        r.a = readField(p, base, end, arena, path, line);
+        r.edge = p < end && *p == ',';
+        if (r.edge) {
+            p++;
+            r.b = readField(p, base, end, arena, path, line);
+            if (p < end && *p == ',') throw lineError(path, line, "expected PRE,POST (too many fields)");
+        } else {
+            r.b = r.a;
+        }
+        if (r.a.len == 0 || r.b.len == 0) throw lineError(path, line, "empty course name");
+        batch.push_back(r);
+        if (batch.size() == CATALOG_BATCH) flush();
+        p++; // past '\n' (or the end)
+    }
+    flush();
+
+    if (anyDeclared) {
+        for (int id = 0; id < cat.names.size(); id++) {
+            if (!declared[id]) {
+                throw lineError(path, firstLine[id],
+                                "unknown course '" + std::string(cat.names.name(id)) + "'");
+            }
+        }
+    }
+
+    cat.graph = Graph(cat.names.size());
+    cat.graph.addEdges(std::move(from), std::move(to));
+    cat.graph.finalize();
+    return cat;
+}
+
+inline Catalog parseSnapshot(const char* p, size_t len, const std::string& path) {
+    auto bad = [&]() { return std::runtime_error("corrupt catalog snapshot: " + path); };
+    uint64_t head[3];
+    if (len < sizeof CATALOG_MAGIC + sizeof head) throw bad();
+    std::memcpy(head, p + sizeof CATALOG_MAGIC, sizeof head);
+    const uint64_t n = head[0], m = head[1], blobBytes = head[2];
+    if (n >= (uint64_t)INT32_MAX || m > len || blobBytes > len) throw bad();
+    const uint64_t need = sizeof CATALOG_MAGIC + sizeof head + (n + 1) * 8 + blobBytes + (n + 1) * 8 + m * 4;
+    if (need != len) throw bad();
+    const char* q = p + sizeof CATALOG_MAGIC + sizeof head;
+
+    Catalog cat;
+    cat.names.offsets.resize(n + 1);
+    std::memcpy(cat.names.offsets.data(), q, (n + 1) * 8);
+    q += (n + 1) * 8;
+    if (cat.names.offsets[0] != 0 || cat.names.offsets[n] != blobBytes) throw bad();
+    for (uint64_t i = 0; i < n; i++) {
+        if (cat.names.offsets[i] > cat.names.offsets[i + 1]) throw bad();
+    }
+    cat.names.blob.assign(q, blobBytes);
+    q += blobBytes;
+
+    std::vector<size_t> offsets(n + 1);
+    std::memcpy(offsets.data(), q, (n + 1) * 8);
+    q += (n + 1) * 8;
+    std::vector<int> targets(m);
+    std::memcpy(targets.data(), q, m * 4);
+    try {
+        cat.graph = Graph(std::move(offsets), std::move(targets));
+    } catch (const std::logic_error&) {
+        throw bad();
+    }
+    return cat;
+}
+
+} // namespace catalog_detail
+
+// Load a text catalog or a snapshot written by saveSnapshot(). Throws runtime_error.
+inline Catalog loadCatalog(const std::string& path) {
+    MappedFile f(path);
+    const char* p = f.data();
+    if (f.size() >= sizeof CATALOG_MAGIC && std::memcmp(p, CATALOG_MAGIC, sizeof CATALOG_MAGIC) == 0) {
+        return catalog_detail::parseSnapshot(p, f.size(), path);
+    }
+    return catalog_detail::parseText(p, p + f.size(), path);
+}
+
+inline void saveSnapshot(Catalog& cat, const std::string& path) {
+    const std::vector<size_t>& off = cat.graph.csrOffsets();
+    const std::vector<int>& tgt = cat.graph.csrTargets();
+    const uint64_t head[3] = {(uint64_t)cat.size(), (uint64_t)tgt.size(), (uint64_t)cat.names.blob.size()};
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot write snapshot: " + path);
+    bool ok = std::fwrite(CATALOG_MAGIC, 1, sizeof CATALOG_MAGIC, f) == sizeof CATALOG_MAGIC
+           && std::fwrite(head, sizeof head, 1, f) == 1
+           && std::fwrite(cat.names.offsets.data(), 8, cat.names.offsets.size(), f) == cat.names.offsets.size()
+           && std::fwrite(cat.names.blob.data(), 1, cat.names.blob.size(), f) == cat.names.blob.size()
+           && std::fwrite(off.data(), 8, off.size(), f) == off.size()
+           && std::fwrite(tgt.data(), 4, tgt.size(), f) == tgt.size();
+    if (std::fclose(f) != 0) ok = false;
+    if (!ok) throw std::runtime_error("cannot write snapshot: " + path);
+}
+
+#endif
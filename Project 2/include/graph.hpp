@@ -2,67 +2,369 @@
 Simple directed graph with DFS-based topological sort.
 Used for course prerequisite ordering in CS 3364 Project 2.
 @Authors: Batuhan Sencer - Larry To
+
+Storage (compressed sparse row):
+- addEdge() only appends to a pending edge list (phase 1).
+- finalize() turns it into two flat arrays (phase 2):
+    offsets[u] .. offsets[u+1]  is the slice of targets[] holding u's out-neighbours.
+  Built with a counting sort, so each node keeps its edges in insertion order
+  (same DFS / Kahn order as the old vector-of-vectors). In-degrees come for free.
+- Edges added after finalize() are merged in by the next finalize(); topoSort()
+  and the accessors finalize on demand.
+- addEdges() appends whole from/to arrays; Graph(offsets, targets) adopts a
+  finished CSR (catalog.hpp uses both).
+
+Topological sort:
+- Iterative DFS with an explicit (node, next-edge) stack, so a 10^6-long chain
+  does not overflow the call stack. Finished nodes are written straight into
+  the output buffer from the back (reverse postorder = same order as before).
+- Visit marks are epoch stamps: each call bumps the epoch, so "clear visited"
+  is O(1) and topoSort() can be called again on the same Graph.
+- A back edge u -> v means a cycle; the gray stack from v to u is the cycle path.
+
+Online edits (DynamicTopoOrder, Pearce-Kelly):
+- Keeps ord[v] (position) and its inverse; addEdge(u, v) with ord[u] < ord[v]
+  is O(1). Otherwise only the nodes placed between v and u can be affected:
+  forward search from v and backward search from u, both limited to that
+  window, then the two found sets are reassigned the same positions (the
+  backward set first). Reaching u from v means a cycle: the edge is rejected
+  and the path returned, without touching the order.
 */
 #ifndef GRAPH_HPP
 #define GRAPH_HPP
 
 #include <vector>
-#include <stack>
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
+#include <algorithm>
+#include <utility>
+
+// Thrown by Graph::topoSort(); cycle = v, ..., u, v (every step is an edge).
+struct CycleError : std::runtime_error {
+    std::vector<int> cycle;
+    explicit CycleError(std::vector<int> path)
+        : std::runtime_error("Cycle detected in prerequisites!"), cycle(std::move(path)) {}
+};
 
 class Graph {
 public:
+    // Read-only view of one node's out-neighbours inside targets[].
+    struct Neighbors {
+        const int* first;
+        const int* last;
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        size_t size() const { return (size_t)(last - first); }
+    };
+
     // TODO: Need to create a graph with n nodes (0..n-1)
     Graph(int n)
-        : adj(n), visited(n, 0) {}
+        : n(n), offsets(n + 1, 0), inDeg(n, 0), mark(n, 0) {}
+
+    // Adopt a finished CSR (offsets has n + 1 entries), e.g. from a catalog snapshot.
+    Graph(std::vector<size_t> csrOffsets, std::vector<int> csrTargets)
+        : n((int)csrOffsets.size() - 1), offsets(std::move(csrOffsets)),
+          targets(std::move(csrTargets)), inDeg(n, 0), mark(n, 0) {
+        if (n < 0 || offsets[0] != 0 || offsets[n] != targets.size()) {
+            throw std::invalid_argument("Graph: malformed CSR offsets");
+        }
+        for (int u = 0; u < n; u++) {
+            if (offsets[u] > offsets[u + 1]) {
+                throw std::invalid_argument("Graph: malformed CSR offsets");
+            }
+        }
+        for (int v : targets) {
+            if (v < 0 || v >= n) throw std::out_of_range("Graph: CSR target out of range");
+            inDeg[v]++;
+        }
+    }
 
     // Add edge u -> v meaning:
     // u must come before v
     void addEdge(int u, int v) {
-        adj[u].push_back(v);
+        if (u < 0 || u >= n || v < 0 || v >= n) {
+            throw std::out_of_range("Graph::addEdge: node id out of range");
+        }
+        pendingFrom.push_back(u);
+        pendingTo.push_back(v);
+    }
+
+    // Phase 1 in bulk: append parallel from/to arrays (moved in when nothing is pending).
+    void addEdges(std::vector<int>&& from, std::vector<int>&& to) {
+        if (from.size() != to.size()) {
+            throw std::invalid_argument("Graph::addEdges: from/to size mismatch");
+        }
+        for (size_t e = 0; e < from.size(); e++) {
+            if (from[e] < 0 || from[e] >= n || to[e] < 0 || to[e] >= n) {
+                throw std::out_of_range("Graph::addEdges: node id out of range");
+            }
+        }
+        if (pendingFrom.empty()) {
+            pendingFrom.swap(from);
+            pendingTo.swap(to);
+        } else {
+            pendingFrom.insert(pendingFrom.end(), from.begin(), from.end());
+            pendingTo.insert(pendingTo.end(), to.begin(), to.end());
+        }
+    }
+
+    // Optional: size the pending list up front when the edge count is known.
+    void reserveEdges(size_t m) {
+        pendingFrom.reserve(m);
+        pendingTo.reserve(m);
+    }
+
+    // Phase 2: merge pending edges into offsets/targets (stable counting sort).
+    void finalize() {
+        if (pendingFrom.empty()) return;
+
+        std::vector<size_t> newOffsets(n + 1, 0);
+        for (int u = 0; u < n; u++) {
+            newOffsets[u + 1] = offsets[u + 1] - offsets[u];
+        }
+        for (int u : pendingFrom) newOffsets[u + 1]++;
+        for (int u = 0; u < n; u++) newOffsets[u + 1] += newOffsets[u];
+
+        // old edges of u first, then its pending edges in insertion order
+        std::vector<int> newTargets(newOffsets[n]);
+        std::vector<size_t> cursor(newOffsets.begin(), newOffsets.end() - 1);
+        for (int u = 0; u < n; u++) {
+            for (size_t e = offsets[u]; e < offsets[u + 1]; e++) {
+                newTargets[cursor[u]++] = targets[e];
+            }
+        }
+        for (size_t e = 0; e < pendingFrom.size(); e++) {
+            newTargets[cursor[pendingFrom[e]]++] = pendingTo[e];
+            inDeg[pendingTo[e]]++;
+        }
+
+        offsets.swap(newOffsets);
+        targets.swap(newTargets);
+        std::vector<int>().swap(pendingFrom);
+        std::vector<int>().swap(pendingTo);
+    }
+
+    int size() const { return n; }
+    size_t edgeCount() const { return targets.size() + pendingFrom.size(); }
+
+    // CSR accessors (finalize first).
+    Neighbors neighbors(int u) {
+        finalize();
+        return {targets.data() + offsets[u], targets.data() + offsets[u + 1]};
+    }
+    const std::vector<int>& inDegrees() {
+        finalize();
+        return inDeg;
+    }
+    const std::vector<size_t>& csrOffsets() {
+        finalize();
+        return offsets;
+    }
+    const std::vector<int>& csrTargets() {
+        finalize();
+        return targets;
     }
 
     // Perform DFS-based Topological Sort.
     // Returns a vector<int> of node IDs in valid order.
-    // Throws runtime_error if cycle is detected.
+    // Throws CycleError (a runtime_error) with the cycle path if one is found.
     std::vector<int> topoSort() {
-        std::stack<int> st;
-        for (int node = 0; node < (int)adj.size(); node++) {
-            if (visited[node] == 0) {
-                dfs(node, st);
-            }
+        std::vector<int> order, cycle;
+        if (!topoSort(order, cycle)) {
+            throw CycleError(std::move(cycle));
         }
+        return order;
+    }
 
-        std::vector<int> result;
-        while (!st.empty()) {
-            result.push_back(st.top());
-            st.pop();
+    // Same, into caller-owned buffers (no allocation once they have capacity n).
+    // Returns false on a cycle: order is then incomplete and cycle holds the path.
+    bool topoSort(std::vector<int>& order, std::vector<int>& cycle) {
+        finalize();
+        order.resize(n);
+        cycle.clear();
+        nextEpoch();
+        const uint32_t gray = epoch, black = epoch + 1;
+        stackNode.resize(n);
+        stackEdge.resize(n);
+        const int* t = targets.data();
+        int out = n; // order[out..n) is filled
+
+        for (int root = 0; root < n; root++) {
+            if (mark[root] >= gray) continue;
+            int top = 0;
+            stackNode[0] = root;
+            stackEdge[0] = offsets[root];
+            mark[root] = gray; // mark as visiting
+
+            while (top >= 0) {
+                int u = stackNode[top];
+                size_t& e = stackEdge[top];
+                if (e < offsets[u + 1]) {
+                    int v = t[e++];
+                    if (mark[v] == gray) {
+                        // hits a gray node => back edge => cycle.
+                        int from = top;
+                        while (stackNode[from] != v) from--;
+                        cycle.assign(stackNode.begin() + from, stackNode.begin() + top + 1);
+                        cycle.push_back(v);
+                        return false;
+                    }
+                    if (mark[v] != black) {
+                        mark[v] = gray;
+                        top++;
+                        stackNode[top] = v;
+                        stackEdge[top] = offsets[v];
+                    }
+                } else {
+                    mark[u] = black; // done
+                    order[--out] = u;
+                    top--;
+                }
+            }
         }
-        return result;
+        return true;
     }
 
 private:
-    std::vector<std::vector<int>> adj;
-    // 0 = not visited, 1 = visiting, 2 = finished
-    std::vector<int> visited;
+    int n;
+    std::vector<size_t> offsets;   // n + 1 entries
+    std::vector<int> targets;      // one entry per edge, grouped by source
+    std::vector<int> inDeg;
+    std::vector<int> pendingFrom, pendingTo;
+
+    // DFS state: mark < epoch = not visited, epoch = visiting, epoch + 1 = finished
+    std::vector<uint32_t> mark;
+    uint32_t epoch = 0;
+    std::vector<int> stackNode;
+    std::vector<size_t> stackEdge;
+
+    void nextEpoch() {
+        if (epoch >= UINT32_MAX - 2) { // wrapped: one real reset every ~2^31 calls
+            std::fill(mark.begin(), mark.end(), 0);
+            epoch = 0;
+        }
+        epoch += 2;
+    }
+};
+
+// Topological order maintained under edge insertions (Pearce-Kelly).
+class DynamicTopoOrder {
+public:
+    // n isolated nodes, order 0..n-1.
+    explicit DynamicTopoOrder(int n)
+        : out(n), in(n), ord(n), node(n), mark(n, 0), parent(n, -1) {
+        for (int v = 0; v < n; v++) ord[v] = node[v] = v;
+    }
 
-    void dfs(int u, std::stack<int>& st) {
-        if (visited[u] == 1) {
-            // hits a gray node => back edge => cycle.
-            throw std::runtime_error("Cycle detected in prerequisites!");
+    // Start from g's edges and g.topoSort() order (throws CycleError on a cycle).
+    explicit DynamicTopoOrder(Graph& g) : DynamicTopoOrder(g.size()) {
+        node = g.topoSort();
+        for (int i = 0; i < (int)node.size(); i++) ord[node[i]] = i;
+        for (int u = 0; u < g.size(); u++) {
+            for (int v : g.neighbors(u)) {
+                out[u].push_back(v);
+                in[v].push_back(u);
+            }
         }
-        if (visited[u] == 2) {
-            return; // already processed
+    }
+
+    int size() const { return (int)ord.size(); }
+    const std::vector<int>& order() const { return node; } // node at each position
+    int position(int v) const { return ord[v]; }
+
+    // Add u -> v. Returns false (order and graph unchanged) if it would close a
+    // cycle; then *cycle (if given) = u, v, ..., u.
+    bool addEdge(int u, int v, std::vector<int>* cycle = nullptr) {
+        const int n = size();
+        if (u < 0 || u >= n || v < 0 || v >= n) {
+            throw std::out_of_range("DynamicTopoOrder::addEdge: node id out of range");
         }
+        if (u == v) {
+            if (cycle) *cycle = {u, u};
+            return false;
+        }
+        const int lb = ord[v], ub = ord[u];
+        if (lb < ub) {
+            nextEpoch();
+            // forward from v, inside the window (ord <= ub)
+            const uint32_t fwd = epoch, bwd = epoch + 1;
+            deltaF.clear();
+            stack.assign(1, v);
+            mark[v] = fwd;
+            parent[v] = -1;
+            while (!stack.empty()) {
+                int w = stack.back();
+                stack.pop_back();
+                deltaF.push_back(w);
+                for (int x : out[w]) {
+                    if (x == u) {
+                        if (cycle) {
+                            cycle->assign(1, u);
+                            size_t from = cycle->size();
+                            for (int y = w; y >= 0; y = parent[y]) cycle->push_back(y);
+                            std::reverse(cycle->begin() + from, cycle->end());
+                            cycle->push_back(u);
+                        }
+                        return false;
+                    }
+                    if (mark[x] != fwd && ord[x] < ub) {
+                        mark[x] = fwd;
+                        parent[x] = w;
+                        stack.push_back(x);
+                    }
+                }
+            }
+            // backward from u, inside the window (ord >= lb)
+            deltaB.clear();
+            stack.assign(1, u);
+            mark[u] = bwd;
+            while (!stack.empty()) {
+                int w = stack.back();
+                stack.pop_back();
+                deltaB.push_back(w);
+                for (int x : in[w]) {
+                    if (mark[x] != bwd && ord[x] > lb) {
+                        mark[x] = bwd;
+                        stack.push_back(x);
+                    }
+                }
+            }
+            reorder();
+        }
+        out[u].push_back(v);
+        in[v].push_back(u);
+        return true;
+    }
 
-        visited[u] = 1; // mark as visiting
+private:
+    std::vector<std::vector<int>> out, in;
+    std::vector<int> ord, node;
+    std::vector<uint32_t> mark;  // same epoch scheme as Graph::topoSort
+    uint32_t epoch = 0;
+    std::vector<int> parent, stack, deltaF, deltaB, slots;
 
-        for (int v : adj[u]) {
-            dfs(v, st);
+    void nextEpoch() {
+        if (epoch >= UINT32_MAX - 2) {
+            std::fill(mark.begin(), mark.end(), 0);
+            epoch = 0;
         }
+        epoch += 2;
+    }
 
-        visited[u] = 2; // done
-        st.push(u);
+    // Backward set (ancestors of u) takes the lowest of the freed positions,
+    // forward set (descendants of v) the rest; each set keeps its relative order.
+    void reorder() {
+        auto byOrd = [&](int a, int b) { return ord[a] < ord[b]; };
+        std::sort(deltaB.begin(), deltaB.end(), byOrd);
+        std::sort(deltaF.begin(), deltaF.end(), byOrd);
+        slots.clear();
+        for (int w : deltaB) slots.push_back(ord[w]);
+        for (int w : deltaF) slots.push_back(ord[w]);
+        std::inplace_merge(slots.begin(), slots.begin() + deltaB.size(), slots.end());
+        size_t i = 0;
+        for (int w : deltaB) { ord[w] = slots[i]; node[slots[i]] = w; i++; }
+        for (int w : deltaF) { ord[w] = slots[i]; node[slots[i]] = w; i++; }
     }
 };
 
@@ -0,0 +1,197 @@
+/*
+Layered topological order (Kahn) over the CSR Graph, optionally multi-threaded.
+Layer 0 = every node with in-degree 0; layer k+1 = nodes whose last prerequisite
+is in layer k. Used by plan_semesters (one layer = one semester).
+@Authors: Batuhan Sencer - Larry To
+
+How it runs:
+- Flat arrays only: all layers live back to back in Layers::nodes, and the
+  current frontier is just the slice of it that was filled last round.
+- In-degrees are std::atomic<int>. A big frontier is cut into one chunk per
+  thread; each thread decrements its targets' in-degrees (fetch_sub) and the
+  one that takes a node to 0 owns it, so every node is emitted exactly once.
+- Each thread sorts what it found, then the sorted chunks are merged, so the
+  layers come out sorted and identical for any thread count (the same output
+  as the old std::set frontier).
+- Small frontiers (fewer than LAYER_PAR_MIN_EDGES outgoing edges) run on the
+  calling thread; starting threads would cost more than the work.
+
+Capped plans (scheduleCapped, plan_semesters --max-per-semester K):
+- List scheduling on top of the layering: a node's priority is its height,
+  the number of courses on the longest chain starting at it (computed over
+  the Kahn order backwards).
+- Ready courses sit in a binary heap keyed by (height desc, id asc). Each
+  semester takes up to K of them; their successors become ready for the
+  next semester. O((V + E) log V), deterministic.
+*/
+#ifndef LAYERS_HPP
+#define LAYERS_HPP
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "graph.hpp"
+
+struct Layers {
+    std::vector<int> nodes;     // layer 0, layer 1, ... each sorted ascending
+    std::vector<size_t> start;  // layer k = nodes[start[k] .. start[k+1])
+
+    int count() const { return (int)start.size() - 1; }
+    const int* begin(int k) const { return nodes.data() + start[k]; }
+    const int* end(int k) const { return nodes.data() + start[k + 1]; }
+};
+
+const size_t LAYER_PAR_MIN_EDGES = 1 << 16;
+
+// Nodes on a cycle (or behind one) are never placed:
+// layers.nodes.size() < g.size() means the graph is not a DAG.
+inline Layers kahnLayers(Graph& g, int threads = 1) {
+    const int n = g.size();
+    const std::vector<size_t>& off = g.csrOffsets();
+    const std::vector<int>& tgt = g.csrTargets();
+    const std::vector<int>& in = g.inDegrees();
+    if (threads < 1) threads = 1;
+
+    Layers L;
+    L.nodes.reserve(n);
+    L.start.push_back(0);
+    std::vector<std::atomic<int>> deg(n);
+    for (int u = 0; u < n; u++) {
+        deg[u].store(in[u], std::memory_order_relaxed);
+        if (in[u] == 0) L.nodes.push_back(u);
+    }
+
+    std::vector<std::vector<int>> found(threads);
+    std::vector<std::thread> pool;
+    size_t begin = 0;
+    while (begin < L.nodes.size()) {
+        const size_t end = L.nodes.size();
+        size_t work = 0;
+        for (size_t i = begin; i < end; i++) {
+            int u = L.nodes[i];
+            work += off[u + 1] - off[u];
+        }
+
+        if (threads == 1 || work < LAYER_PAR_MIN_EDGES) {
+            // serial: plain load/store on the atomics, no locked instructions
+            for (size_t i = begin; i < end; i++) {
+                int u = L.nodes[i];
+                for (size_t e = off[u]; e < off[u + 1]; e++) {
+                    int v = tgt[e];
+                    int d = deg[v].load(std::memory_order_relaxed) - 1;
+                    deg[v].store(d, std::memory_order_relaxed);
+                    if (d == 0) L.nodes.push_back(v);
+                }
+            }
+            std::sort(L.nodes.begin() + end, L.nodes.end());
+        } else {
+            const size_t chunk = (end - begin + threads - 1) / threads;
+            auto expand = [&](int t) {
+                std::vector<int>& mine = found[t];
+                mine.clear();
+                size_t lo = std::min(end, begin + t * chunk);
+                size_t hi = std::min(end, lo + chunk);
+                for (size_t i = lo; i < hi; i++) {
+                    int u = L.nodes[i];
+                    for (size_t e = off[u]; e < off[u + 1]; e++) {
+                        int v = tgt[e];
+                        if (deg[v].fetch_sub(1, std::memory_order_relaxed) == 1) {
+                            mine.push_back(v);
+                        }
+                    }
+                }
+                std::sort(mine.begin(), mine.end());
+            };
+            pool.clear();
+            for (int t = 1; t < threads; t++) pool.emplace_back(expand, t);
+            expand(0);
+            for (std::thread& th : pool) th.join();
+
+            // append the sorted runs, then merge neighbouring runs pairwise
+            std::vector<size_t> runs{end};
+            for (int t = 0; t < threads; t++) {
+                L.nodes.insert(L.nodes.end(), found[t].begin(), found[t].end());
+                runs.push_back(L.nodes.size());
+            }
+            while (runs.size() > 2) {
+                std::vector<size_t> merged{runs[0]};
+                for (size_t r = 0; r + 2 < runs.size(); r += 2) {
+                    std::inplace_merge(L.nodes.begin() + runs[r], L.nodes.begin() + runs[r + 1],
+                                       L.nodes.begin() + runs[r + 2]);
+                    merged.push_back(runs[r + 2]);
+                }
+                if (runs.size() % 2 == 0) merged.push_back(runs.back());
+                runs.swap(merged);
+            }
+        }
+
+        L.start.push_back(end);
+        begin = end;
+    }
+    return L;
+}
+
+// Semesters of at most maxPerSemester courses (each sorted ascending).
+// Same convention as kahnLayers: fewer than g.size() nodes placed = cycle.
+inline Layers scheduleCapped(Graph& g, int maxPerSemester, int threads = 1) {
+    const int n = g.size();
+    const std::vector<size_t>& off = g.csrOffsets();
+    const std::vector<int>& tgt = g.csrTargets();
+    Layers kahn = kahnLayers(g, threads);
+
+    Layers L;
+    L.start.push_back(0);
+    if ((int)kahn.nodes.size() != n || maxPerSemester < 1) {
+        return L;
+    }
+
+    // longest remaining chain, successors first
+    std::vector<int> height(n, 1);
+    for (size_t i = kahn.nodes.size(); i-- > 0;) {
+        int u = kahn.nodes[i];
+        int h = 0;
+        for (size_t e = off[u]; e < off[u + 1]; e++) h = std::max(h, height[tgt[e]]);
+        height[u] = h + 1;
+    }
+    auto key = [&](int u) {
+        return ((uint64_t)height[u] << 32) | (uint64_t)(UINT32_MAX - (uint32_t)u);
+    };
+
+    std::vector<int> deg = g.inDegrees();
+    std::vector<uint64_t> heap;
+    for (int u = 0; u < n; u++) {
+        if (deg[u] == 0) heap.push_back(key(u));
+    }
+    std::make_heap(heap.begin(), heap.end());
+
+    L.nodes.reserve(n);
+    std::vector<int> released;
+    while (!heap.empty()) {
+        const size_t first = L.nodes.size();
+        for (int k = 0; k < maxPerSemester && !heap.empty(); k++) {
+            std::pop_heap(heap.begin(), heap.end());
+            L.nodes.push_back((int)(UINT32_MAX - (uint32_t)heap.back()));
+            heap.pop_back();
+        }
+        // successors may only start next semester
+        released.clear();
+        for (size_t i = first; i < L.nodes.size(); i++) {
+            int u = L.nodes[i];
+            for (size_t e = off[u]; e < off[u + 1]; e++) {
+                if (--deg[tgt[e]] == 0) released.push_back(tgt[e]);
+            }
+        }
+        for (int v : released) {
+            heap.push_back(key(v));
+            std::push_heap(heap.begin(), heap.end());
+        }
+        std::sort(L.nodes.begin() + first, L.nodes.end());
+        L.start.push_back(L.nodes.size());
+    }
+    return L;
+}
+
+#endif
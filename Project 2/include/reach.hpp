@@ -0,0 +1,133 @@
+/*
+Reachability index: "is A a (transitive) prerequisite of B?" without a DFS per question.
+@Authors: Batuhan Sencer - Larry To
+
+Dense index (n * n bits fit in the memory budget):
+- desc[u] is a bitset over all nodes: bit v set <=> there is a path u -> ... -> v.
+- Built once in reverse topological order, so every successor's row is final:
+      desc[u] = OR over edges u -> v of (desc[v] | {v})
+  The OR runs a machine word (SSE2: 128 bits) at a time.
+- reaches(a, b) is one bit test: O(1).
+
+Chunked fallback (too many nodes for n * n bits):
+- Targets are cut into column chunks of as many bits as the budget allows for
+  n rows. A chunk's closure is built the same way, restricted to its columns.
+- answer() groups a batch of questions by the chunk of B, builds only chunks
+  that are asked about, one at a time, and answers from each.
+  Memory = budget; time = (V + E) * chunk words per chunk used.
+
+The index keeps a reference to the Graph (it must outlive the index).
+*/
+#ifndef REACH_HPP
+#define REACH_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include "graph.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const size_t REACH_DEFAULT_BYTES = size_t(1) << 30; // 1 GiB
+
+// dst[i] |= src[i] for w words.
+inline void orWords(uint64_t* dst, const uint64_t* src, size_t w) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 2 <= w; i += 2) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(d, s));
+    }
+#endif
+    for (; i < w; i++) dst[i] |= src[i];
+}
+
+class ReachIndex {
+public:
+    // Throws CycleError if g has a cycle.
+    explicit ReachIndex(Graph& g, size_t maxBytes = REACH_DEFAULT_BYTES)
+        : g(g), n(g.size()), topo(g.topoSort()) {
+        const size_t words = ((size_t)n + 63) / 64;
+        if (n == 0 || (size_t)n * words * 8 <= maxBytes) {
+            chunkBits = words * 64;
+        } else {
+            size_t w = std::max<size_t>(1, maxBytes / ((size_t)n * 8));
+            chunkBits = std::min(words, w) * 64;
+        }
+        if (isDense()) {
+            build(0, rows);
+        }
+    }
+
+    bool isDense() const { return chunkBits >= (size_t)n; }
+    size_t bytes() const { return rows.size() * 8; }
+
+    // Is a a (transitive) prerequisite of b? Dense index only.
+    bool reaches(int a, int b) const {
+        return (rows[(size_t)a * rowWords + ((size_t)b >> 6)] >> (b & 63)) & 1;
+    }
+    bool isAncestor(int a, int b) const { return reaches(a, b); }
+    bool isDescendant(int a, int b) const { return reaches(b, a); }
+
+    // Answers out[i] = reaches(q[i].first, q[i].second) in either mode.
+    void answer(const std::vector<std::pair<int, int>>& q, std::vector<char>& out) {
+        out.assign(q.size(), 0);
+        if (isDense()) {
+            for (size_t i = 0; i < q.size(); i++) out[i] = reaches(q[i].first, q[i].second);
+            return;
+        }
+        // bucket the questions by the chunk of their target
+        const size_t chunks = ((size_t)n + chunkBits - 1) / chunkBits;
+        std::vector<size_t> head(chunks + 1, 0), idx(q.size());
+        for (const auto& p : q) head[(size_t)p.second / chunkBits + 1]++;
+        for (size_t c = 0; c < chunks; c++) head[c + 1] += head[c];
+        std::vector<size_t> fill(head.begin(), head.end() - 1);
+        for (size_t i = 0; i < q.size(); i++) idx[fill[(size_t)q[i].second / chunkBits]++] = i;
+
+        std::vector<uint64_t> chunkRows;
+        for (size_t c = 0; c < chunks; c++) {
+            if (head[c] == head[c + 1]) continue;
+            build(c, chunkRows);
+            const size_t lo = c * chunkBits;
+            for (size_t k = head[c]; k < head[c + 1]; k++) {
+                size_t i = idx[k];
+                size_t col = (size_t)q[i].second - lo;
+                out[i] = (chunkRows[(size_t)q[i].first * rowWords + (col >> 6)] >> (col & 63)) & 1;
+            }
+        }
+    }
+
+private:
+    Graph& g;
+    int n;
+    std::vector<int> topo;
+    size_t chunkBits = 0;
+    size_t rowWords = 0;
+    std::vector<uint64_t> rows; // dense: n rows of rowWords words
+
+    // Closure restricted to target columns [c * chunkBits, (c + 1) * chunkBits).
+    void build(size_t c, std::vector<uint64_t>& out) {
+        const size_t lo = c * chunkBits;
+        const size_t hi = std::min((size_t)n, lo + chunkBits);
+        rowWords = (hi - lo + 63) / 64;
+        out.assign((size_t)n * rowWords, 0);
+        const std::vector<size_t>& off = g.csrOffsets();
+        const std::vector<int>& tgt = g.csrTargets();
+        for (size_t i = topo.size(); i-- > 0;) {
+            const int u = topo[i];
+            uint64_t* row = out.data() + (size_t)u * rowWords;
+            for (size_t e = off[u]; e < off[u + 1]; e++) {
+                const size_t v = (size_t)tgt[e];
+                orWords(row, out.data() + v * rowWords, rowWords);
+                if (v >= lo && v < hi) row[(v - lo) >> 6] |= uint64_t(1) << ((v - lo) & 63);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,195 @@
+// Benchmark: CSR Graph (graph.hpp) vs the old vector<vector<int>> adjacency.
+// Random layered DAG (edges only go to later layers, so it is acyclic and the
+// baseline's recursive DFS stays shallow). Times build, DFS topo sort and Kahn
+// layering, then repeated topoSort calls and an n-long chain (CSR only), then
+// the old std::set semester layering vs kahnLayers (layers.hpp) at 1 and N threads,
+// then local online inserts into a DynamicTopoOrder.
+//
+//   make bench                                 (10^6 nodes, 10^7 edges)
+//   make bench BENCH_ARGS="2000000 20000000"   (nodes edges)
+// @AUTHORS: Batuhan Sencer - Larry To
+
+#include <iostream>
+#include <vector>
+#include <stack>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <set>
+#include <thread>
+#include "graph.hpp"
+#include "layers.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// The layout graph.hpp used before CSR, kept here as the baseline.
+struct VecGraph {
+    std::vector<std::vector<int>> adj;
+    std::vector<int> inDegree, visited;
+    VecGraph(int n) : adj(n), inDegree(n, 0), visited(n, 0) {}
+    void addEdge(int u, int v) { adj[u].push_back(v); inDegree[v]++; }
+    void dfs(int u, std::stack<int>& st) {
+        if (visited[u] == 1) throw std::runtime_error("cycle");
+        if (visited[u] == 2) return;
+        visited[u] = 1;
+        for (int v : adj[u]) dfs(v, st);
+        visited[u] = 2;
+        st.push(u);
+    }
+    std::vector<int> topoSort() {
+        std::stack<int> st;
+        for (int u = 0; u < (int)adj.size(); u++) if (visited[u] == 0) dfs(u, st);
+        std::vector<int> r;
+        while (!st.empty()) { r.push_back(st.top()); st.pop(); }
+        return r;
+    }
+};
+
+// Plain Kahn layering over any graph type; returns the number of layers.
+template <class Adj>
+static int kahnLayers(int n, std::vector<int> inDeg, Adj&& out) {
+    std::vector<int> cur, next;
+    for (int i = 0; i < n; i++) if (inDeg[i] == 0) cur.push_back(i);
+    int layers = 0;
+    while (!cur.empty()) {
+        layers++;
+        next.clear();
+        for (int u : cur)
+            for (int v : out(u))
+                if (--inDeg[v] == 0) next.push_back(v);
+        cur.swap(next);
+    }
+    return layers;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    long long m = argc > 2 ? std::atoll(argv[2]) : 10000000;
+    const int LAYERS = 64;
+
+    // edge u -> v with layer(u) < layer(v); layer(i) = i % LAYERS on shuffled ids
+    std::mt19937_64 rng(42);
+    std::vector<int> perm(n);
+    for (int i = 0; i < n; i++) perm[i] = i;
+    std::shuffle(perm.begin(), perm.end(), rng);
+    std::vector<int> eu(m), ev(m);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    for (long long e = 0; e < m; e++) {
+        int a = pick(rng), b = pick(rng);
+        while (a % LAYERS == b % LAYERS) b = pick(rng);
+        if (a % LAYERS > b % LAYERS) std::swap(a, b);
+        eu[e] = perm[a];
+        ev[e] = perm[b];
+    }
+    std::cout << "nodes " << n << ", edges " << m << "\n";
+
+    auto t0 = Clock::now();
+    VecGraph vg(n);
+    for (long long e = 0; e < m; e++) vg.addEdge(eu[e], ev[e]);
+    double vBuild = msSince(t0);
+    t0 = Clock::now();
+    std::vector<int> vOrder = vg.topoSort();
+    double vTopo = msSince(t0);
+    t0 = Clock::now();
+    int vLayers = kahnLayers(n, vg.inDegree, [&](int u) -> const std::vector<int>& { return vg.adj[u]; });
+    double vKahn = msSince(t0);
+
+    t0 = Clock::now();
+    Graph g(n);
+    g.reserveEdges(m);
+    for (long long e = 0; e < m; e++) g.addEdge(eu[e], ev[e]);
+    g.finalize();
+    double cBuild = msSince(t0);
+    t0 = Clock::now();
+    std::vector<int> cOrder = g.topoSort();
+    double cTopo = msSince(t0);
+    t0 = Clock::now();
+    int cLayers = kahnLayers(n, g.inDegrees(), [&](int u) { return g.neighbors(u); });
+    double cKahn = msSince(t0);
+
+    if (vOrder != cOrder || vLayers != cLayers) {
+        std::cerr << "ERROR: CSR and vector-of-vectors results differ\n";
+        return 1;
+    }
+
+    std::cout << "                 build_ms   topo_ms   kahn_ms\n";
+    std::cout << "vector<vector>  " << vBuild << "  " << vTopo << "  " << vKahn << "\n";
+    std::cout << "CSR             " << cBuild << "  " << cTopo << "  " << cKahn << "\n";
+    std::cout << "layers " << cLayers << " (same order and layers in both)\n";
+
+    // Repeated calls reuse the marks (epoch bump) and the caller's buffers.
+    std::vector<int> order, cycle;
+    t0 = Clock::now();
+    const int REPEAT = 5;
+    for (int r = 0; r < REPEAT; r++) {
+        if (!g.topoSort(order, cycle) || order != cOrder) {
+            std::cerr << "ERROR: repeated topoSort differs\n";
+            return 1;
+        }
+    }
+    std::cout << "topoSort into buffers, warm: " << msSince(t0) / REPEAT << " ms per call\n";
+
+    // One n-long chain: the recursive DFS would need n stack frames here.
+    Graph chain(n);
+    for (int i = n - 1; i > 0; i--) chain.addEdge(perm[i - 1], perm[i]);
+    t0 = Clock::now();
+    if (!chain.topoSort(order, cycle) || order[0] != perm[0] || order[n - 1] != perm[n - 1]) {
+        std::cerr << "ERROR: chain order is wrong\n";
+        return 1;
+    }
+    std::cout << "chain of " << n << ": " << msSince(t0) << " ms\n";
+
+    // Semester layering as plan_semesters used to do it (std::set frontiers).
+    t0 = Clock::now();
+    std::vector<int> setNodes;
+    {
+        std::vector<int> inDeg = g.inDegrees();
+        std::set<int> available;
+        for (int i = 0; i < n; i++) if (inDeg[i] == 0) available.insert(i);
+        while (!available.empty()) {
+            std::set<int> nextAvailable;
+            for (int u : available) {
+                setNodes.push_back(u);
+                for (int v : g.neighbors(u)) if (--inDeg[v] == 0) nextAvailable.insert(v);
+            }
+            available = nextAvailable;
+        }
+    }
+    double setMs = msSince(t0);
+    std::cout << "layers std::set     " << setMs << " ms\n";
+
+    int hw = std::max(2, (int)std::thread::hardware_concurrency());
+    for (int threads : {1, hw}) {
+        t0 = Clock::now();
+        Layers L = kahnLayers(g, threads);
+        double ms = msSince(t0);
+        if (L.nodes != setNodes || L.count() != cLayers) {
+            std::cerr << "ERROR: kahnLayers differs from the std::set layering\n";
+            return 1;
+        }
+        std::cout << "layers kahnLayers/" << threads << "  " << ms << " ms\n";
+    }
+
+    // Online inserts (Pearce-Kelly) vs one full topoSort per edit. Edits are
+    // local: both ends within 64 positions of each other, either direction.
+    DynamicTopoOrder dyn(g);
+    const int EDITS = 10000;
+    int accepted = 0;
+    std::uniform_int_distribution<int> near(-64, 64);
+    t0 = Clock::now();
+    for (int k = 0; k < EDITS; k++) {
+        int pu = pick(rng);
+        int pv = std::min(n - 1, std::max(0, pu + near(rng)));
+        accepted += dyn.addEdge(dyn.order()[pu], dyn.order()[pv]);
+    }
+    double pkMs = msSince(t0);
+    std::cout << "DynamicTopoOrder: " << EDITS << " local inserts (" << accepted << " accepted) "
+              << pkMs * 1000 / EDITS << " us each; a full topoSort is " << cTopo << " ms\n";
+    return 0;
+}
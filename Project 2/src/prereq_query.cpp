@@ -0,0 +1,112 @@
+/*
+TODO: Answers "is A a (transitive) prerequisite of B?" for a batch of questions.
+Usage: prereq_query [CATALOG] [--mem-mb M] < questions
+  CATALOG    text catalog or binary snapshot (default data/courses.csv)
+  --mem-mb M memory for the reachability index (default 1024); larger
+             catalogs are answered chunk by chunk (see include/reach.hpp)
+Each stdin line is PRE,POST (same field rules as the catalog). Each answer line
+is "yes", "no" or "error: ...", in input order (blank and # lines get none).
+@AUTHORS: Batuhan Sencer - Larry To
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdlib>
+#include <utility>
+#include <memory>
+#include "graph.hpp"
+#include "catalog.hpp"
+#include "reach.hpp"
+
+int main(int argc, char** argv) {
+    std::string catalogPath = "data/courses.csv";
+    size_t memBytes = REACH_DEFAULT_BYTES;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--mem-mb") == 0 && i + 1 < argc) {
+            memBytes = (size_t)std::atoll(argv[++i]) << 20;
+        } else if (argv[i][0] != '-') {
+            catalogPath = argv[i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [CATALOG] [--mem-mb M] < questions\n";
+            return 1;
+        }
+    }
+
+    // -----------------------------------------------------------------
+    // TODO: Load the catalog and build the reachability index
+    // @AUTHOR: Batuhan Sencer - Larry To
+    // -----------------------------------------------------------------
+    Catalog cat;
+    try {
+        cat = loadCatalog(catalogPath);
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading catalog: " << e.what() << "\n";
+        return 1;
+    }
+    std::unique_ptr<ReachIndex> index;
+    try {
+        index = std::make_unique<ReachIndex>(cat.graph, memBytes);
+    } catch (const CycleError& e) {
+        std::cerr << "Error: catalog has a prerequisite cycle:";
+        for (int i = 0; i < (int)e.cycle.size(); i++) {
+            std::cerr << (i ? " -> " : " ") << cat.name(e.cycle[i]);
+        }
+        std::cerr << "\n";
+        return 1;
+    }
+
+    // -----------------------------------------------------------------
+    // TODO: Read every question first, then answer them as one batch
+    // @AUTHOR: Batuhan Sencer - Larry To
+    // -----------------------------------------------------------------
+    std::vector<std::pair<int, int>> questions;
+    std::vector<std::string> errors; // per line; empty = valid question
+    std::string line, arena;
+    size_t lineNo = 0;
+    while (std::getline(std::cin, line)) {
+        lineNo++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        const char* base = line.data();
+        const char* p = base;
+        const char* end = base + line.size();
+        try {
+            arena.clear();
+            catalog_detail::Field a = catalog_detail::readField(p, base, end, arena, "stdin", lineNo);
+            if (p >= end || *p != ',') throw catalog_detail::lineError("stdin", lineNo, "expected PRE,POST");
+            p++;
+            catalog_detail::Field b = catalog_detail::readField(p, base, end, arena, "stdin", lineNo);
+            if (p < end) throw catalog_detail::lineError("stdin", lineNo, "expected PRE,POST (too many fields)");
+            auto view = [&](const catalog_detail::Field& f) {
+                return std::string_view((f.quoted ? arena.data() : base) + f.pos, f.len);
+            };
+            int u = cat.names.find(view(a));
+            int v = cat.names.find(view(b));
+            if (u < 0 || v < 0) {
+                throw catalog_detail::lineError("stdin", lineNo,
+                                                "unknown course '" + std::string(view(u < 0 ? a : b)) + "'");
+            }
+            questions.push_back({u, v});
+            errors.emplace_back();
+        } catch (const std::exception& e) {
+            errors.push_back(e.what());
+        }
+    }
+
+    std::vector<char> yes;
+    index->answer(questions, yes);
+
+    std::string out;
+    size_t q = 0;
+    for (const std::string& err : errors) {
+        if (!err.empty()) {
+            out += "error: " + err + "\n";
+        } else {
+            out += yes[q++] ? "yes\n" : "no\n";
+        }
+    }
+    std::cout << out;
+    return 0;
+}